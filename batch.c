@@ -0,0 +1,109 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+#include <stdint.h>
+
+#include "batch.h"
+
+// Cache lines prefetched per block, at most. A block of 128 integers takes 9
+// lines at 32 bits; the rest of larger blocks is left to the hardware
+// prefetcher, which follows the decoder once the first lines are in.
+#define BATCH_PREFETCH_LINES 16
+
+// Lists decoded at the same time. More lists hide more latency, but past a
+// few the interleaved input and output streams defeat the hardware
+// prefetcher and the blocks of a round no longer stay in L1.
+#define BATCH_GROUP 8
+
+// State of a list in batch_decode.
+struct batch_state {
+  const struct batch_list *list;
+  int block;      // next block to decode, prefetched
+  int num_blocks;
+  long decoded;   // integers written to the output
+};
+
+// Prefetches the compressed words of block 'block', and the directory entry
+// of the one after, which gives where the next prefetch starts.
+static void prefetch_block(const struct batch_list *l, int block, int num_blocks) {
+  const char *p = (const char *) (l->data + l->dir[block].offset);
+  long end = (block + 1 < num_blocks) ? l->dir[block + 1].offset : l->data_words;
+  long bytes = (end - l->dir[block].offset) * sizeof(unsigned int);
+  const char *q;
+
+  if (bytes > BATCH_PREFETCH_LINES * 64)
+    bytes = BATCH_PREFETCH_LINES * 64;
+  for (q = (const char *) ((uintptr_t) p & ~(uintptr_t) 63); q < p + bytes; q += 64)
+    __builtin_prefetch(q, 0, 3);
+  if (block + 2 < num_blocks)
+    __builtin_prefetch(&l->dir[block + 2], 0, 3);
+}
+
+void batch_list_open(struct batch_list *l, const struct container *c, unsigned int *output) {
+  const struct container_header *h = c->header;
+
+  l->data = c->data;
+  l->dir = c->dir;
+  l->num_elements = h->num_elements;
+  l->data_words = h->data_words;
+  l->codec = h->codec;
+  l->block_size = h->block_size;
+  l->flags = h->flags;
+  l->output = output;
+}
+
+// Starts list 'l' in state 's', prefetching its first block. Returns 0 if
+// the list is empty.
+static int start_list(struct batch_state *s, const struct batch_list *l) {
+  if (l->num_elements <= 0)
+    return 0;
+  s->list = l;
+  s->block = 0;
+  s->num_blocks = (l->num_elements + l->block_size - 1) / l->block_size;
+  s->decoded = 0;
+  prefetch_block(l, 0, s->num_blocks);
+  return 1;
+}
+
+long batch_decode(struct batch_list *lists, int k) {
+  struct batch_state state[BATCH_GROUP];
+  struct batch_state *s;
+  const struct batch_list *l;
+  long n = 0;
+  int i, left, next;
+
+  for (left = 0, next = 0; (left < BATCH_GROUP) && (next < k); next++)
+    left += start_list(&state[left], &lists[next]);
+
+  // Each step decodes the block a list was waiting for and prefetches its next
+  // one, which has the steps of the other lists to arrive. A finished list
+  // hands its place to the next list of the batch, or to the last one of the
+  // group when there are no more.
+  while (left > 0) {
+    for (i = 0; i < left; ) {
+      s = &state[i];
+      l = s->list;
+      s->decoded += block_decode(l->data, l->dir, s->block, l->num_elements, l->codec,
+                                 l->block_size, l->flags, l->output + s->decoded);
+      if (++s->block < s->num_blocks) {
+        prefetch_block(l, s->block, s->num_blocks);
+        i++;
+        continue;
+      }
+      n += s->decoded;
+      while ((next < k) && !start_list(s, &lists[next]))
+        next++;
+      if (next < k)
+        next++;
+      else
+        state[i] = state[--left];
+    }
+  }
+  return n;
+}
@@ -0,0 +1,54 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Batch decoding of many compressed lists, for queries touching tens of
+// terms. Decoding the lists one after the other stalls on the cold blocks of
+// each one in turn. Here the lists are decoded together, one block of each
+// at a time: when a block is decoded the next block of its list is
+// prefetched, and it loads while the blocks of the other lists are decoded,
+// so there are many loads in flight at the same time.
+//
+// Each list is a small state machine (the block it waits for, prefetched in
+// the previous round), and the scheduler goes round robin over a group of
+// them (BATCH_GROUP in batch.c); a list that finishes hands its place to
+// the next one of the batch.
+//
+// Usage:
+//   struct batch_list lists[k];
+//   for (i = 0; i < k; i++)
+//     batch_list_open(&lists[i], &containers[i], outputs[i]);
+//   batch_decode(lists, k);
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "container.h"
+
+// A list of a batch, stored with the container layout (see block_decode in
+// container.h), and where to decode it.
+struct batch_list {
+  const unsigned int *data;
+  const struct block_entry *dir;
+  long num_elements;
+  long data_words;      // compressed words, they bound the last block
+  int codec;
+  int block_size;
+  int flags;
+  unsigned int *output; // room for an upper multiple of block_size integers
+};
+
+// Fills 'l' to decode an opened container into 'output'.
+void batch_list_open(struct batch_list *l, const struct container *c, unsigned int *output);
+
+// Decodes the 'k' lists, each into its output, the same as block_decode on
+// every block. Returns the total number of integers decoded.
+long batch_decode(struct batch_list *lists, int k);
+
+#endif /* BATCH_H_ */
@@ -0,0 +1,376 @@
+////
+// Benchmark of the codecs over sorted integer arrays (docIDs).
+//
+// Usage: bench [-n integers] [-g mean gap] [-r runs] [-s seed] [-f file]
+//
+// Without -f it generates three workloads of 'n' docIDs:
+//   - uniform: gaps uniformly distributed with the given mean,
+//   - zipf: gaps following a Zipf distribution (s = 1.1) over [1, 65536],
+//   - clustered: docIDs in dense clusters, as in Anh and Moffat's generator.
+// With -f it reads posting lists from a binary file, each list stored as its
+// length followed by its docIDs, all of them 32-bit little-endian integers.
+//
+// Every codec compresses the d-gaps of each list (the sorted mode), it is run
+// 'runs' times, and it reports the mean and standard deviation of the
+// encoding and decoding speed, plus the size in bits per integer.
+// When built with -DCODEC_STATS it also prints the counters of one encoding
+// run: the b chosen by PForDelta and its exceptions, or the Simple16 selectors.
+//
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<time.h>
+#include<unistd.h>
+#include "s16.h"
+#include "s8b.h"
+#include "coding_policy.h"
+#include "coding_policy_helper.h"
+#include "codec_stats.h"
+
+struct workload {
+  const char *name;
+  int num_lists;
+  int *sizes;             // integers in each list
+  unsigned int **lists;   // the docIDs
+  long total;             // integers in all lists
+};
+
+enum { S16, S8B, PFORDELTA };
+
+struct codec {
+  const char *name;
+  int type;
+  int block_size;         // PForDelta block size
+  int flags;              // format flags of PForDelta, see coding_policy.h
+};
+
+#define MAX_BLOCK_SIZE 4096 // largest block size of the codecs
+
+static const struct codec codecs[] = {
+  {"s16", S16, 0, 0},
+  {"s8b", S8B, 0, 0},
+  {"pfordelta-32", PFORDELTA, 32, 0},
+  {"pfordelta-64", PFORDELTA, 64, 0},
+  {"pfordelta-128", PFORDELTA, 128, 0},
+  {"pfordelta-256", PFORDELTA, 256, 0},
+  {"pfordelta-1024", PFORDELTA, 1024, 0},
+  {"pfordelta-4096", PFORDELTA, 4096, 0},
+  {"optpfd-128", PFORDELTA, 128, PFOR_OPTIMAL},
+  {"newpfd-128", PFORDELTA, 128, PFOR_NEWPFD},
+  {"optnewpfd-128", PFORDELTA, 128, PFOR_NEWPFD | PFOR_OPTIMAL},
+  {"hybrid-128", PFORDELTA, 128, PFOR_HYBRID},
+};
+
+static double now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// xorshift64*, so the workloads do not depend on the libc rand()
+static unsigned long long seed = 1;
+
+static unsigned int next_random() {
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return (unsigned int) ((seed * 2685821657736338717ULL) >> 32);
+}
+
+static unsigned int random_below(unsigned int n) {
+  return (unsigned int) (((unsigned long long) next_random() * n) >> 32);
+}
+
+static void single_list(struct workload *w, const char *name, int n) {
+  w->name = name;
+  w->num_lists = 1;
+  w->total = n;
+  w->sizes = malloc(sizeof(int));
+  w->sizes[0] = n;
+  w->lists = malloc(sizeof(unsigned int *));
+  w->lists[0] = malloc(n * sizeof(unsigned int));
+}
+
+static void gen_uniform(struct workload *w, int n, unsigned int gap) {
+  unsigned int x = 0;
+  int i;
+
+  single_list(w, "uniform", n);
+  for (i = 0; i < n; i++) {
+    x += 1 + random_below(2 * gap - 1);
+    w->lists[0][i] = x;
+  }
+}
+
+static void gen_zipf(struct workload *w, int n) {
+  const int range = 65536;
+  const double s = 1.1;
+  double *cdf = malloc(range * sizeof(double));
+  double sum = 0, u;
+  unsigned int x = 0;
+  int i, lo, hi, mid;
+
+  for (i = 0; i < range; i++) {
+    sum += 1.0 / pow(i + 1, s);
+    cdf[i] = sum;
+  }
+
+  single_list(w, "zipf", n);
+  for (i = 0; i < n; i++) {
+    u = (next_random() / 4294967296.0) * sum;
+    for (lo = 0, hi = range - 1; lo < hi;) {
+      mid = (lo + hi) / 2;
+      if (cdf[mid] < u)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    x += lo + 1;
+    w->lists[0][i] = x;
+  }
+  free(cdf);
+}
+
+static int compare_uint(const void *a, const void *b) {
+  unsigned int x = *(const unsigned int *) a;
+  unsigned int y = *(const unsigned int *) b;
+  return (x > y) - (x < y);
+}
+
+// Fills out[0..n) with distinct sorted integers in [min, max).
+static void fill_clustered(unsigned int *out, int n, unsigned int min, unsigned int max) {
+  unsigned int range = max - min;
+  unsigned int cut;
+  int i, j;
+
+  if (n == 0)
+    return;
+  if (range == (unsigned int) n) {
+    for (i = 0; i < n; i++)
+      out[i] = min + i;
+    return;
+  }
+  if (n < 10) {
+    for (i = 0; i < n;) {
+      out[i] = min + random_below(range);
+      for (j = 0; (j < i) && (out[j] != out[i]); j++)
+        ;
+      if (j == i)
+        i++;
+    }
+    qsort(out, n, sizeof(unsigned int), compare_uint);
+    return;
+  }
+  cut = n / 2 + random_below(range - n + 1);
+  fill_clustered(out, n / 2, min, min + cut);
+  fill_clustered(out + n / 2, n - n / 2, min + cut, max);
+}
+
+static void gen_clustered(struct workload *w, int n, unsigned int gap) {
+  single_list(w, "clustered", n);
+  fill_clustered(w->lists[0], n, 1, 1 + (unsigned int) n * gap);
+}
+
+static int load_lists(struct workload *w, const char *file) {
+  FILE *f = fopen(file, "rb");
+  unsigned int len;
+  int capacity = 1024;
+
+  if (f == NULL) {
+    perror(file);
+    return -1;
+  }
+
+  w->name = file;
+  w->num_lists = 0;
+  w->total = 0;
+  w->sizes = malloc(capacity * sizeof(int));
+  w->lists = malloc(capacity * sizeof(unsigned int *));
+  while (fread(&len, sizeof(unsigned int), 1, f) == 1) {
+    if (w->num_lists == capacity) {
+      capacity *= 2;
+      w->sizes = realloc(w->sizes, capacity * sizeof(int));
+      w->lists = realloc(w->lists, capacity * sizeof(unsigned int *));
+    }
+    w->lists[w->num_lists] = malloc(len * sizeof(unsigned int));
+    if (fread(w->lists[w->num_lists], sizeof(unsigned int), len, f) != len) {
+      fprintf(stderr, "%s: truncated list %d\n", file, w->num_lists);
+      free(w->lists[w->num_lists]);
+      break;
+    }
+    w->sizes[w->num_lists++] = len;
+    w->total += len;
+  }
+  fclose(f);
+  return 0;
+}
+
+// Both return the size in 32-bit words.
+static int encode(const struct codec *c, unsigned int *in, unsigned int *out, int n) {
+  if (c->type == S16)
+    return s16_compress_sorted(in, out, n);
+  if (c->type == S8B)
+    return 2 * s8b_compress_sorted(in, (unsigned long long *) out, n);
+  return compress_pfordelta_dir(in, out, n, c->block_size, NULL, PFOR_SORTED | c->flags);
+}
+
+static int decode(const struct codec *c, unsigned int *in, unsigned int *out, int n) {
+  if (c->type == S16)
+    return s16_decompress_sorted(in, out, n);
+  if (c->type == S8B)
+    return 2 * s8b_decompress_sorted((unsigned long long *) in, out, n);
+  return decompress_pfordelta_sorted(in, out, n, c->block_size);
+}
+
+static void mean_sd(double *x, int n, double *mean, double *sd) {
+  double sum = 0, sq = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    sum += x[i];
+  *mean = sum / n;
+  for (i = 0; i < n; i++)
+    sq += (x[i] - *mean) * (x[i] - *mean);
+  *sd = (n > 1) ? sqrt(sq / (n - 1)) : 0;
+}
+
+// Prints the non-zero counters of the last encoding run.
+static void print_stats() {
+  struct codec_stats s;
+  int i;
+
+  if (!codec_stats_get(&s))
+    return;
+  if (s.pfor_blocks > 0) {
+    printf("  b:");
+    for (i = 0; i <= 32; i++)
+      if (s.pfor_b[i] > 0)
+        printf(" %d:%lu", i, s.pfor_b[i]);
+    printf("\n  candidates rejected:");
+    for (i = 0; i <= 32; i++)
+      if (s.pfor_rejected[i] > 0)
+        printf(" %d:%lu", i, s.pfor_rejected[i]);
+    printf("\n  exceptions: %lu (%lu forced), blocks with 8/16/32 bits exceptions: %lu/%lu/%lu\n",
+           s.pfor_exceptions, s.pfor_forced, s.pfor_exception_blocks[0],
+           s.pfor_exception_blocks[1], s.pfor_exception_blocks[2]);
+  }
+  if ((s.pfor_constant > 0) || (s.pfor_s16 > 0))
+    printf("  hybrid: %lu constant blocks, %lu Simple16 blocks\n", s.pfor_constant, s.pfor_s16);
+  if (s.s16_words > 0) {
+    printf("  selectors:");
+    for (i = 0; i < 16; i++)
+      printf(" %lu", s.s16_selector[i]);
+    printf("\n");
+  }
+}
+
+static void run(struct workload *w, const struct codec *c, int runs) {
+  unsigned int **coded = malloc(w->num_lists * sizeof(unsigned int *));
+  int *words = malloc(w->num_lists * sizeof(int));
+  unsigned int *out;
+  double *enc = malloc(runs * sizeof(double));
+  double *dec = malloc(runs * sizeof(double));
+  double t, enc_mean, enc_sd, dec_mean, dec_sd;
+  long total_words = 0;
+  int max = 0;
+  int i, r;
+
+  for (i = 0; i < w->num_lists; i++) {
+    coded[i] = malloc(CompressedOutBufferUpperbound(UncompressedInBufferUpperbound(w->sizes[i], MAX_BLOCK_SIZE)) * sizeof(unsigned int) + 64);
+    if (w->sizes[i] > max)
+      max = w->sizes[i];
+  }
+  out = malloc(UncompressedOutBufferUpperbound(UncompressedInBufferUpperbound(max, MAX_BLOCK_SIZE)) * sizeof(unsigned int));
+
+  for (r = 0; r < runs; r++) {
+    codec_stats_reset();
+    t = now();
+    for (i = 0; i < w->num_lists; i++)
+      words[i] = encode(c, w->lists[i], coded[i], w->sizes[i]);
+    enc[r] = w->total / ((now() - t) * 1e9);
+
+    t = now();
+    for (i = 0; i < w->num_lists; i++)
+      decode(c, coded[i], out, w->sizes[i]);
+    dec[r] = w->total / ((now() - t) * 1e9);
+  }
+
+  // Check every list outside of the timed loops.
+  for (i = 0; i < w->num_lists; i++) {
+    if (words[i] < 0) {
+      // Simple16 in its original format, with a gap of 2^28 or more.
+      fprintf(stderr, "%s: %s cannot compress list %d\n", w->name, c->name, i);
+      goto done;
+    }
+    total_words += words[i];
+    decode(c, coded[i], out, w->sizes[i]);
+    if (memcmp(out, w->lists[i], w->sizes[i] * sizeof(unsigned int)) != 0) {
+      fprintf(stderr, "%s: %s does not decode list %d to the input\n", w->name, c->name, i);
+      exit(1);
+    }
+  }
+
+  mean_sd(enc, runs, &enc_mean, &enc_sd);
+  mean_sd(dec, runs, &dec_mean, &dec_sd);
+  printf("%-12s %-14s %8.3f %8.3f %7.3f %9.1f %8.3f %7.3f %9.1f\n", w->name, c->name,
+         32.0 * total_words / w->total,
+         enc_mean, enc_sd, enc_mean * 4e3,
+         dec_mean, dec_sd, dec_mean * 4e3);
+  print_stats();
+
+done:
+  for (i = 0; i < w->num_lists; i++)
+    free(coded[i]);
+  free(coded);
+  free(words);
+  free(out);
+  free(enc);
+  free(dec);
+}
+
+int main(int argc, char *argv[]) {
+  struct workload workloads[3];
+  int num_workloads = 0;
+  int n = 1 << 22;
+  unsigned int gap = 16;
+  int runs = 5;
+  char *file = NULL;
+  int opt, i, j;
+
+  while ((opt = getopt(argc, argv, "n:g:r:s:f:")) != -1) {
+    switch (opt) {
+      case 'n': n = atoi(optarg); break;
+      case 'g': gap = atoi(optarg); break;
+      case 'r': runs = atoi(optarg); break;
+      case 's': seed = strtoull(optarg, NULL, 10) | 1; break;
+      case 'f': file = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-n integers] [-g mean gap] [-r runs] [-s seed] [-f file]\n", argv[0]);
+        return 1;
+    }
+  }
+  if ((n <= 0) || (gap == 0) || (runs <= 0)) {
+    fprintf(stderr, "%s: -n, -g and -r must be positive\n", argv[0]);
+    return 1;
+  }
+
+  if (file != NULL) {
+    if (load_lists(&workloads[num_workloads++], file) != 0)
+      return 1;
+  } else {
+    gen_uniform(&workloads[num_workloads++], n, gap);
+    gen_zipf(&workloads[num_workloads++], n);
+    gen_clustered(&workloads[num_workloads++], n, gap);
+  }
+
+  printf("%-12s %-14s %8s %8s %7s %9s %8s %7s %9s\n", "workload", "codec", "bits/int",
+         "enc i/ns", "sd", "enc MB/s", "dec i/ns", "sd", "dec MB/s");
+  for (i = 0; i < num_workloads; i++) {
+    for (j = 0; j < (int) (sizeof(codecs) / sizeof(codecs[0])); j++)
+      run(&workloads[i], &codecs[j], runs);
+  }
+
+  return 0;
+}
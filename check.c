@@ -0,0 +1,691 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Round-trip check of every codec and mode: each one compresses arrays of
+// several distributions and lengths and must decode them back. It prints the
+// failing cases and exits with 1 if there is any. Run it with 'make check'.
+//
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<unistd.h>
+#include "s16.h"
+#include "s8b.h"
+#include "pfordelta.h"
+#include "coding_policy.h"
+#include "pfor_stream.h"
+#include "container.h"
+#include "cursor.h"
+#include "intersect.h"
+#include "batch.h"
+
+#define NUM_DISTS 7
+#define MAX_SIZE 10000
+
+static const int block_sizes[] = {32, 128, 1024, 4096};
+#define NUM_BLOCK_SIZES (int) (sizeof(block_sizes) / sizeof(block_sizes[0]))
+
+static int failures = 0;
+static int cases = 0;
+
+static unsigned long long seed = 88172645463325252ULL;
+
+// xorshift64, the same sequence on every platform.
+static unsigned int rnd() {
+  seed ^= seed << 13;
+  seed ^= seed >> 7;
+  seed ^= seed << 17;
+  return (unsigned int) seed;
+}
+
+// Integer 'i' of distribution 'dist', at most 'max'.
+static unsigned int gen(int dist, int i, unsigned int max) {
+  unsigned int x;
+
+  switch (dist) {
+    case 0: x = 0; break;
+    case 1: x = rnd() & 7; break;
+    case 2: x = (rnd() % 50 == 0) ? rnd() & 0xFFFF : rnd() & 3; break;
+    case 3: x = (rnd() % 10 == 0) ? rnd() : rnd() & 0xFF; break;
+    case 4: x = rnd() >> (rnd() % 32); break;
+    case 5: x = rnd() & ((1u << (i % 32)) - 1); break;
+    default: x = rnd(); break;
+  }
+  return x > max ? max : x;
+}
+
+static void fill(unsigned int *v, int n, int dist, unsigned int max) {
+  int i;
+
+  for (i = 0; i < n; i++)
+    v[i] = gen(dist, i, max);
+}
+
+// Sorted array whose gaps follow 'dist', at most 'max', the sum is kept below 2^32.
+static void fill_sorted(unsigned int *v, int n, int dist, unsigned int max) {
+  unsigned int x = 0;
+  int i;
+
+  if (max > 0xFFFFFFFFu / (n + 1))
+    max = 0xFFFFFFFFu / (n + 1);
+  for (i = 0; i < n; i++) {
+    x += gen(dist, i, max);
+    v[i] = x;
+  }
+}
+
+// Strictly increasing list whose gaps follow 'dist', ending at 0xFFFFFFFF.
+static void fill_strict(unsigned int *v, int n, int dist) {
+  int i;
+
+  fill_sorted(v, n, dist, 0xFFFFFFFFu);
+  for (i = 0; i < n; i++)
+    v[i] += i;
+  v[n - 1] = 0xFFFFFFFFu;
+}
+
+static void expect(int ok, const char *what, int dist, int block_size, int flags, int n) {
+  cases++;
+  if (!ok) {
+    printf("%s: fails for distribution %d, block size %d, flags %d, %d integers\n", what, dist, block_size, flags, n);
+    failures++;
+  }
+}
+
+static int same(unsigned int *a, unsigned int *b, int n) {
+  return memcmp(a, b, n * sizeof(unsigned int)) == 0;
+}
+
+static void check_pfordelta(unsigned int *in, unsigned int *coded, unsigned int *out, int n, int dist) {
+  struct block_entry *dir, *mt_dir;
+  unsigned int *offsets;
+  int b, bs, flags, words, used, num_blocks, block;
+  struct pfor_stream s;
+
+  for (b = 0; b < NUM_BLOCK_SIZES; b++) {
+    bs = block_sizes[b];
+    num_blocks = (n + bs - 1) / bs;
+    dir = malloc(num_blocks * sizeof(struct block_entry));
+    offsets = malloc((num_blocks + 1) * sizeof(unsigned int));
+    mt_dir = malloc(num_blocks * sizeof(struct block_entry));
+    for (flags = 0; flags < 16; flags++) {
+      if (flags & PFOR_SORTED)
+        fill_sorted(in, n, dist, 0xFFFFFFFFu);
+      else
+        fill(in, n, dist, 0xFFFFFFFFu);
+
+      words = compress_pfordelta_dir(in, coded, n, bs, dir, flags);
+      if (flags & PFOR_SORTED)
+        used = decompress_pfordelta_sorted(coded, out, n, bs);
+      else
+        used = decompress_pfordelta(coded, out, n, bs);
+      expect(used == words && same(in, out, n), "compress_pfordelta_dir", dist, bs, flags, n);
+
+      pfor_block_offsets(coded, num_blocks, bs, offsets);
+      expect(offsets[num_blocks] == words, "pfor_block_offsets", dist, bs, flags, n);
+      for (block = 0; block < num_blocks; block += 3) {
+        decompress_pfordelta_block(coded, dir, block, out, bs, flags);
+        expect(dir[block].offset == offsets[block] && same(in + block * bs, out, block == num_blocks - 1 ? n - block * bs : bs),
+               "decompress_pfordelta_block", dist, bs, flags, n);
+      }
+
+      pfor_stream_init(&s, out, bs, flags);
+      pfor_stream_add_n(&s, in, n);
+      used = pfor_stream_finish(&s);
+      expect(used == words && same(coded, out, words), "pfor_stream", dist, bs, flags, n);
+
+      memcpy(mt_dir, dir, num_blocks * sizeof(struct block_entry));
+      used = compress_pfordelta_mt(in, out, n, bs, dir, flags, 4);
+      expect(used == words && same(coded, out, words) && memcmp(dir, mt_dir, num_blocks * sizeof(struct block_entry)) == 0,
+             "compress_pfordelta_mt", dist, bs, flags, n);
+      used = decompress_pfordelta_mt(coded, dir, out, n, bs, flags, 4);
+      expect(used == words && same(in, out, n), "decompress_pfordelta_mt", dist, bs, flags, n);
+    }
+    free(mt_dir);
+    free(dir);
+    free(offsets);
+  }
+}
+
+static void check_container(unsigned int *in, unsigned int *out, int n, int dist) {
+  static const int codecs[] = {CODEC_PFORDELTA, CODEC_S16, CODEC_S16_ESC};
+  char path[] = "/tmp/check-codecs-XXXXXX";
+  struct container c;
+  int fd, i, flags, ok;
+
+  fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    exit(1);
+  }
+  close(fd);
+  for (i = 0; i < 3; i++) {
+    for (flags = 0; flags <= PFOR_SORTED; flags++) {
+      if ((flags & PFOR_SORTED) && (codecs[i] == CODEC_S16))
+        fill_sorted(in, n, dist, (1u << 28) - 1);
+      else if (flags & PFOR_SORTED)
+        fill_sorted(in, n, dist, 0xFFFFFFFFu);
+      else
+        fill(in, n, dist, (codecs[i] == CODEC_S16) ? (1u << 28) - 1 : 0xFFFFFFFFu);
+      ok = (container_write(path, in, n, codecs[i], 128, flags) == 0) && (container_open(&c, path) == 0);
+      if (ok) {
+        ok = (container_decode(&c, out) == n) && same(in, out, n);
+        container_close(&c);
+      }
+      expect(ok, "container", dist, 128, flags, n);
+    }
+  }
+  unlink(path);
+}
+
+// Creates an empty temporary file from the template 'path'.
+static void make_temp(char *path) {
+  int fd = mkstemp(path);
+
+  if (fd < 0) {
+    perror("mkstemp");
+    exit(1);
+  }
+  close(fd);
+}
+
+// Writes the 'n' integers of 'in' to the container 'path' in blocks of 128
+// and opens it. Returns 1 if both succeed.
+static int open_list(struct container *c, const char *path, unsigned int *in, int n, int codec, int flags) {
+  return (container_write(path, in, n, codec, 128, flags) == 0) && (container_open(c, path) == 0);
+}
+
+// Index of the first integer >= 'target' of 'in' from 'i', n if there is none.
+static int next_geq(unsigned int *in, int i, int n, unsigned int target) {
+  while ((i < n) && (in[i] < target))
+    i++;
+  return i;
+}
+
+// Moves a cursor over a strictly increasing list with cursor_next,
+// cursor_next_geq and cursor_next_block, checking each position against the
+// array. The targets of cursor_next_geq go from the current integer to jumps
+// of several blocks, the last one is 0xFFFFFFFF, the last integer.
+static void check_cursor(unsigned int *in, int n, int dist) {
+  static const int codecs[] = {CODEC_PFORDELTA, CODEC_S16_ESC};
+  char path[] = "/tmp/check-codecs-XXXXXX";
+  struct container ct;
+  struct cursor c;
+  unsigned int target, r;
+  int i, j, k, len, flags, ok;
+
+  make_temp(path);
+  fill_strict(in, n, dist);
+  for (k = 0; k < 2; k++) {
+    for (flags = 0; flags <= PFOR_SORTED; flags++) {
+      if (!open_list(&ct, path, in, n, codecs[k], flags)) {
+        expect(0, "cursor, container", dist, 128, flags, n);
+        continue;
+      }
+
+      ok = (cursor_open(&c, &ct) == 0);
+      for (i = 0; ok && (i < n); i++) {
+        ok = !cursor_end(&c) && (cursor_value(&c) == in[i]) && (cursor_index(&c) == i) &&
+             (cursor_block(&c)[cursor_pos(&c)] == in[i]) && (cursor_next(&c) == (i < n - 1));
+      }
+      expect(ok && cursor_end(&c) && !cursor_next(&c), "cursor_next", dist, 128, flags, n);
+      cursor_close(&c);
+
+      ok = (cursor_open(&c, &ct) == 0);
+      for (i = 0, target = 0; ok && (i < n - 1); i = j) {
+        j = next_geq(in, i, n, target);
+        ok = (cursor_next_geq(&c, target) == 1) && (cursor_value(&c) == in[j]) && (cursor_index(&c) == j);
+        r = rnd();
+        switch (r % 4) {
+          case 0: target = in[j] + 1; break;
+          case 1: target = in[(j + r % 8 < n) ? j + r % 8 : n - 1]; break;
+          case 2: target = in[(j + r % 1000 < n) ? j + r % 1000 : n - 1] - 1; break;
+          default: target = (in[j] < 0xFFFFFFFFu - 64) ? in[j] + 64 : 0xFFFFFFFFu; break;
+        }
+      }
+      // The last integer is 0xFFFFFFFF, no target goes past it.
+      ok = ok && (cursor_next_geq(&c, 0xFFFFFFFFu) == 1) && (cursor_index(&c) == n - 1) &&
+           !cursor_next(&c) && !cursor_next_geq(&c, 0);
+      expect(ok && cursor_end(&c), "cursor_next_geq", dist, 128, flags, n);
+      cursor_close(&c);
+
+      ok = (cursor_open(&c, &ct) == 0) && (cursor_next_geq(&c, 0xFFFFFFFFu) == 1) &&
+           (cursor_index(&c) == n - 1) && (cursor_value(&c) == 0xFFFFFFFFu) && !cursor_next(&c);
+      expect(ok, "cursor_next_geq, 0xFFFFFFFF", dist, 128, flags, n);
+      cursor_close(&c);
+
+      ok = (cursor_open(&c, &ct) == 0);
+      for (i = 0; ok && (i < n); i += 128) {
+        len = (n - i < 128) ? n - i : 128;
+        ok = !cursor_end(&c) && (cursor_value(&c) == in[i]) && (cursor_index(&c) == i) && (cursor_pos(&c) == 0) &&
+             (cursor_len(&c) == len) && (cursor_block_last(&c) == in[i + len - 1]) &&
+             same((unsigned int *) cursor_block(&c), in + i, len) && (cursor_next_block(&c) == (i + 128 < n));
+      }
+      expect(ok && cursor_end(&c) && !cursor_next_block(&c), "cursor_next_block", dist, 128, flags, n);
+      cursor_close(&c);
+      container_close(&ct);
+    }
+  }
+  unlink(path);
+}
+
+// Intersection of two strictly increasing arrays, merging them.
+static int merge_common(unsigned int *a, int na, unsigned int *b, int nb, unsigned int *output) {
+  int i = 0, j = 0, k = 0;
+
+  while ((i < na) && (j < nb)) {
+    if (a[i] == b[j]) {
+      output[k++] = a[i];
+      i++;
+      j++;
+    } else if (a[i] < b[j]) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+  return k;
+}
+
+// Integers of 'u' kept one time out of 'q', and its last one, 0xFFFFFFFF.
+static int sample(unsigned int *u, int n, int q, unsigned int *v) {
+  int i, k = 0;
+
+  for (i = 0; i < n - 1; i++) {
+    if (rnd() % q == 0)
+      v[k++] = u[i];
+  }
+  v[k++] = u[n - 1];
+  return k;
+}
+
+// Intersects lists sampled from a strictly increasing list 'u' with
+// intersect, intersect_array and intersect_k, against merge_common. The
+// pairs have the same density, very different ones (the short side is
+// searched with cursor_next_geq), or are the same list; the first list is
+// also intersected from the middle. Every list ends at 0xFFFFFFFF.
+static void check_intersect(unsigned int *u, int n, int dist) {
+  static const int densities[][3] = {{2, 2, 3}, {1, 64, 2}, {64, 1, 1}, {1, 1, 1}, {3, 200, 5}};
+  char path[3][32];
+  unsigned int *lists[3], *ref = malloc(n * sizeof(unsigned int)), *out = malloc(n * sizeof(unsigned int));
+  struct container ct[3];
+  struct cursor c[3], *k_lists[3];
+  int len[3], d, i, m, r, start, ok;
+
+  fill_strict(u, n, dist);
+  for (i = 0; i < 3; i++) {
+    strcpy(path[i], "/tmp/check-codecs-XXXXXX");
+    make_temp(path[i]);
+    lists[i] = malloc(n * sizeof(unsigned int));
+  }
+  for (d = 0; d < (int) (sizeof(densities) / sizeof(densities[0])); d++) {
+    ok = 1;
+    for (i = 0; i < 3; i++) {
+      if (densities[d][i] == 1) {
+        memcpy(lists[i], u, n * sizeof(unsigned int));
+        len[i] = n;
+      } else {
+        len[i] = sample(u, n, densities[d][i], lists[i]);
+      }
+      // The lists mix the codecs and modes the cursors read.
+      ok = ok && open_list(&ct[i], path[i], lists[i], len[i], (i == 1) ? CODEC_S16_ESC : CODEC_PFORDELTA, (i == 2) ? 0 : PFOR_SORTED);
+    }
+    if (!ok) {
+      expect(0, "intersect, container", dist, 128, d, n);
+      continue;
+    }
+
+    m = merge_common(lists[0], len[0], lists[1], len[1], ref);
+    ok = (cursor_open(&c[0], &ct[0]) == 0) && (cursor_open(&c[1], &ct[1]) == 0);
+    ok = ok && (intersect(&c[0], &c[1], out) == m) && same(out, ref, m);
+    cursor_close(&c[0]);
+    cursor_close(&c[1]);
+    expect(ok, "intersect", dist, 128, d, n);
+
+    ok = (cursor_open(&c[0], &ct[0]) == 0);
+    ok = ok && (intersect_array(&c[0], lists[1], len[1], out) == m) && same(out, ref, m);
+    cursor_close(&c[0]);
+    expect(ok, "intersect_array", dist, 128, d, n);
+
+    // From the middle of the first list.
+    start = len[0] / 2;
+    m = merge_common(lists[0] + start, len[0] - start, lists[1], len[1], ref);
+    ok = (cursor_open(&c[0], &ct[0]) == 0) && (cursor_open(&c[1], &ct[1]) == 0) &&
+         (cursor_next_geq(&c[0], lists[0][start]) == 1);
+    ok = ok && (intersect(&c[1], &c[0], out) == m) && same(out, ref, m);
+    cursor_close(&c[0]);
+    cursor_close(&c[1]);
+    expect(ok, "intersect, from the middle", dist, 128, d, n);
+
+    // One list as it is, the last two, and the three of them.
+    for (r = 1; r <= 3; r++) {
+      if (r == 1) {
+        m = len[0];
+        memcpy(ref, lists[0], m * sizeof(unsigned int));
+      } else if (r == 2) {
+        m = merge_common(lists[1], len[1], lists[2], len[2], ref);
+      } else {
+        m = merge_common(lists[0], len[0], lists[1], len[1], ref);
+        m = merge_common(ref, m, lists[2], len[2], ref);
+      }
+      ok = 1;
+      for (i = 0; i < 3; i++) {
+        ok = (cursor_open(&c[i], &ct[i]) == 0) && ok;
+        k_lists[i] = &c[i];
+      }
+      ok = ok && (intersect_k((r == 2) ? k_lists + 1 : k_lists, (r == 1) ? 1 : r, out) == m) && same(out, ref, m);
+      for (i = 0; i < 3; i++)
+        cursor_close(&c[i]);
+      expect(ok, "intersect_k", dist, 128, r, n);
+    }
+    for (i = 0; i < 3; i++)
+      container_close(&ct[i]);
+  }
+  for (i = 0; i < 3; i++) {
+    unlink(path[i]);
+    free(lists[i]);
+  }
+  free(ref);
+  free(out);
+}
+
+// Decodes BATCH_LISTS lists of every codec, mode, several block sizes and
+// lengths, an empty one included, with one batch_decode call. There are more
+// lists than batch_decode keeps in flight, so finished lists hand their
+// place to the next ones.
+#define BATCH_LISTS 20
+static void check_batch(int dist) {
+  static const int codecs[] = {CODEC_PFORDELTA, CODEC_S16, CODEC_S16_ESC};
+  static const int lengths[] = {1000, 1, 0, 4097, 128, 129, 31, 10000};
+  static const int list_block_sizes[] = {128, 32, 1024};
+  char path[BATCH_LISTS][32];
+  unsigned int *in[BATCH_LISTS];
+  struct container ct[BATCH_LISTS];
+  struct batch_list lists[BATCH_LISTS];
+  long total = 0;
+  int i, n, bs, codec, flags, ok = 1;
+
+  for (i = 0; i < BATCH_LISTS; i++) {
+    n = lengths[i % 8];
+    bs = list_block_sizes[i % 3];
+    codec = codecs[(i / 3) % 3];
+    flags = (i / 2) % 2;
+    in[i] = malloc((n + bs) * sizeof(unsigned int));
+    if (flags & PFOR_SORTED)
+      fill_sorted(in[i], n, dist, (codec == CODEC_S16) ? (1u << 28) - 1 : 0xFFFFFFFFu);
+    else
+      fill(in[i], n, dist, (codec == CODEC_S16) ? (1u << 28) - 1 : 0xFFFFFFFFu);
+    strcpy(path[i], "/tmp/check-codecs-XXXXXX");
+    make_temp(path[i]);
+    if ((container_write(path[i], in[i], n, codec, bs, flags) != 0) || (container_open(&ct[i], path[i]) != 0)) {
+      expect(0, "batch_decode, container", dist, bs, flags, n);
+      exit(1);
+    }
+    batch_list_open(&lists[i], &ct[i], malloc((n + bs) * sizeof(unsigned int)));
+    total += n;
+  }
+
+  ok = (batch_decode(lists, BATCH_LISTS) == total);
+  for (i = 0; i < BATCH_LISTS; i++) {
+    ok = ok && same(in[i], lists[i].output, lengths[i % 8]);
+    container_close(&ct[i]);
+    unlink(path[i]);
+    free(lists[i].output);
+    free(in[i]);
+  }
+  expect(ok, "batch_decode", dist, 0, 0, total);
+}
+
+// 2^28 - 1 alone in a word is a word of the original Simple16 format that
+// looks like S16_ESCAPE, it must still decode as it did.
+static void check_s16_format(unsigned int *out) {
+  unsigned int in[4] = {5, (1u << 28) - 1, 7, 9};
+  unsigned int coded[8];
+  int words, used;
+
+  words = s16_compress(in, coded, 4);
+  used = s16_decompress(coded, out, 4);
+  expect(used == words && coded[1] == S16_ESCAPE && same(in, out, 4), "s16_compress, 2^28 - 1", 0, 0, 0, 4);
+  used = s16_decompress_sorted(coded, out, 4);
+  expect(used == words && out[3] == in[0] + in[1] + in[2] + in[3], "s16_decompress_sorted, 2^28 - 1", 0, 0, PFOR_SORTED, 4);
+  words = s16_compress_esc(in, coded, 4);
+  used = s16_decompress_esc(coded, out, 4);
+  expect(used == words && same(in, out, 4), "s16_compress_esc, 2^28 - 1", 0, 0, 0, 4);
+}
+
+// The original Simple16 format stops at 2^28: the compressors must refuse
+// an integer or a gap of 2^28, and container_write must not write the file.
+static void check_s16_range(unsigned int *in, unsigned int *coded) {
+  char path[] = "/tmp/check-codecs-XXXXXX";
+  int fd, i, n = 200;
+
+  for (i = 0; i < n; i++)
+    in[i] = i;
+  in[150] = 1u << 28;
+  expect(s16_compress(in, coded, n) == -1, "s16_compress, 2^28", 0, 0, 0, n);
+  expect(s16_compress_esc(in, coded, n) > 0, "s16_compress_esc, 2^28", 0, 0, 0, n);
+  fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    exit(1);
+  }
+  close(fd);
+  unlink(path);
+  errno = 0;
+  expect(container_write(path, in, n, CODEC_S16, 128, 0) == -1 && errno == EINVAL && access(path, F_OK) != 0,
+         "container_write, CODEC_S16 and 2^28", 0, 128, 0, n);
+
+  for (i = 0; i < n; i++)
+    in[i] = i;
+  for (i = 150; i < n; i++)
+    in[i] += (1u << 28) - 2;
+  expect(s16_compress_sorted(in, coded, n) > 0, "s16_compress_sorted, gap 2^28 - 1", 0, 0, PFOR_SORTED, n);
+  for (i = 150; i < n; i++)
+    in[i]++;
+  expect(s16_compress_sorted(in, coded, n) == -1, "s16_compress_sorted, gap 2^28", 0, 0, PFOR_SORTED, n);
+  errno = 0;
+  expect(container_write(path, in, n, CODEC_S16, 128, PFOR_SORTED) == -1 && errno == EINVAL && access(path, F_OK) != 0,
+         "container_write, CODEC_S16 and gap 2^28", 0, 128, PFOR_SORTED, n);
+  unlink(path);
+}
+
+// Blocks of 10 integers of 32 bits, the rest of 31 bits: b = 31 leaves 10
+// exceptions of 32 bits, more than the integers as they are.
+static void check_wide_blocks(unsigned int *in, unsigned int *coded, unsigned int *out) {
+  struct block_entry dir[3];
+  int b, bs, i, n, words, used;
+
+  for (b = 0; b < NUM_BLOCK_SIZES; b++) {
+    bs = block_sizes[b];
+    n = 3 * bs;
+    for (i = 0; i < n; i++)
+      in[i] = (i % bs < 10) ? 0x80000000u | rnd() : 0x40000000u | (rnd() >> 2);
+    words = compress_pfordelta(in, coded, n, bs);
+    used = decompress_pfordelta(coded, out, n, bs);
+    expect(used == words && words <= 3 * (bs + 1) && same(in, out, n), "compress_pfordelta, wide blocks", 0, bs, 0, n);
+    words = compress_pfordelta_dir(in, coded, n, bs, NULL, PFOR_NEWPFD);
+    used = decompress_pfordelta(coded, out, n, bs);
+    expect(used == words && words <= 3 * (bs + 1) && same(in, out, n), "compress_pfordelta, wide blocks", 0, bs, PFOR_NEWPFD, n);
+    words = compress_pfordelta_mt(in, coded, n, bs, dir, 0, 4);
+    used = decompress_pfordelta_mt(coded, dir, out, n, bs, 0, 4);
+    expect(used == words && same(in, out, n), "compress_pfordelta_mt, wide blocks", 0, bs, 0, n);
+  }
+}
+
+// Blocks of PFOR_MAX_BLOCK_SIZE, whose scratch arrays come from the heap,
+// compressed by several threads, and block sizes the compressors refuse.
+static void check_max_blocks(void) {
+  static const int modes[] = {0, PFOR_SORTED, PFOR_NEWPFD, PFOR_SORTED | PFOR_OPTIMAL | PFOR_HYBRID};
+  static const int bad_sizes[] = {0, 48, PFOR_MAX_BLOCK_SIZE + 32};
+  int bs = PFOR_MAX_BLOCK_SIZE;
+  int n = bs + 1000;
+  unsigned int *in = malloc(n * sizeof(unsigned int));
+  unsigned int *coded = malloc(2 * (2 * bs + 1) * sizeof(unsigned int));
+  unsigned int *out = malloc(2 * bs * sizeof(unsigned int));
+  unsigned long long *in64 = malloc(n * sizeof(unsigned long long));
+  unsigned long long *out64 = malloc(2 * bs * sizeof(unsigned long long));
+  struct block_entry dir[2];
+  struct pfor_stream s;
+  int m, i, words, used;
+
+  for (m = 0; m < 4; m++) {
+    if (modes[m] & PFOR_SORTED)
+      fill_sorted(in, n, 3, 0xFFFFFFFFu);
+    else
+      fill(in, n, 3, 0xFFFFFFFFu);
+    words = compress_pfordelta_mt(in, coded, n, bs, dir, modes[m], 2);
+    used = decompress_pfordelta_mt(coded, dir, out, n, bs, modes[m], 2);
+    expect(words > 0 && used == words && same(in, out, n), "compress_pfordelta_mt, largest blocks", 3, bs, modes[m], n);
+  }
+
+  for (m = 0; m < 2; m++) {
+    for (i = 0; i < n; i++)
+      in64[i] = (m == 0) ? (unsigned long long) gen(3, i, 0xFFFFFFFFu) << (rnd() % 32) : (i > 0 ? in64[i - 1] : 0) + gen(3, i, 0xFFFFFFFFu);
+    words = compress_pfordelta64(in64, coded, n, bs, (m == 0) ? 0 : PFOR_SORTED | PFOR_OPTIMAL);
+    used = decompress_pfordelta64(coded, out64, n, bs, (m == 0) ? 0 : PFOR_SORTED);
+    expect(words > 0 && used == words && memcmp(in64, out64, n * sizeof(unsigned long long)) == 0,
+           "compress_pfordelta64, largest blocks", 3, bs, (m == 0) ? 0 : PFOR_SORTED | PFOR_OPTIMAL, n);
+  }
+
+  for (i = 0; i < (int) (sizeof(bad_sizes) / sizeof(bad_sizes[0])); i++) {
+    expect(compress_pfordelta_dir(in, coded, 100, bad_sizes[i], NULL, 0) == -1 &&
+           compress_pfordelta_sorted(in, coded, 100, bad_sizes[i]) == -1 &&
+           compress_pfordelta_mt(in, coded, 100, bad_sizes[i], NULL, 0, 2) == -1 &&
+           compress_pfordelta64(in64, coded, 100, bad_sizes[i], 0) == -1 &&
+           pfor_stream_init(&s, coded, bad_sizes[i], 0) == -1,
+           "invalid block size", 0, bad_sizes[i], 0, 100);
+  }
+
+  free(in);
+  free(coded);
+  free(out);
+  free(in64);
+  free(out64);
+}
+
+static void check_pfordelta64(unsigned int *coded, int n, int dist) {
+  unsigned long long *in = malloc((n + 4096) * sizeof(unsigned long long));
+  unsigned long long *out = malloc((n + 4096) * sizeof(unsigned long long));
+  static const int modes[] = {0, PFOR_SORTED, PFOR_OPTIMAL, PFOR_SORTED | PFOR_OPTIMAL};
+  unsigned long long x = 0;
+  int m, flags, i, words, used;
+
+  for (m = 0; m < 4; m++) {
+    flags = modes[m];
+    for (i = 0; i < n; i++) {
+      if (flags & PFOR_SORTED)
+        in[i] = x += gen(dist, i, 0xFFFFFFFFu);
+      else
+        in[i] = (unsigned long long) gen(dist, i, 0xFFFFFFFFu) << (rnd() % 32) | rnd();
+    }
+    words = compress_pfordelta64(in, coded, n, 128, flags);
+    used = decompress_pfordelta64(coded, out, n, 128, flags);
+    expect(used == words && memcmp(in, out, n * sizeof(unsigned long long)) == 0, "compress_pfordelta64", dist, 128, flags, n);
+  }
+  free(in);
+  free(out);
+}
+
+// 64-bit Simple16: integers of 'dist' shifted to any width, with the
+// widths around the escape (2^28 - 1) and the 32-bit halves mixed in, and
+// sorted arrays of such gaps ending at 2^64 - 1.
+static void check_s16_64(unsigned int *coded, int n, int dist) {
+  static const unsigned long long edges[] = {(1ULL << 28) - 2, (1ULL << 28) - 1, 1ULL << 28, 0xFFFFFFFFULL,
+                                             1ULL << 32, 0xFFFFFFFFFFFFFFFFULL};
+  unsigned long long *in = malloc(n * sizeof(unsigned long long));
+  unsigned long long *out = malloc(n * sizeof(unsigned long long));
+  unsigned long long x;
+  int i, words, used;
+
+  for (i = 0; i < n; i++)
+    in[i] = (rnd() % 16 == 0) ? edges[rnd() % 6] : (unsigned long long) gen(dist, i, 0xFFFFFFFFu) << (rnd() % 33);
+  words = s16_compress64(in, coded, n);
+  used = s16_decompress64(coded, out, n);
+  expect(used == words && memcmp(in, out, n * sizeof(unsigned long long)) == 0, "s16_compress64", dist, 0, 0, n);
+
+  // Gaps up to 2^32, the sum stays far from 2^64, and a last gap close to it.
+  for (x = 0, i = 0; i < n; i++) {
+    x += (rnd() % 16 == 0) ? edges[rnd() % 5] : gen(dist, i, 0xFFFFFFFFu) >> (rnd() % 32);
+    in[i] = x;
+  }
+  in[n - 1] = 0xFFFFFFFFFFFFFFFFULL;
+  words = s16_compress64_sorted(in, coded, n);
+  used = s16_decompress64_sorted(coded, out, n);
+  expect(used == words && memcmp(in, out, n * sizeof(unsigned long long)) == 0, "s16_compress64_sorted", dist, 0, PFOR_SORTED, n);
+  free(in);
+  free(out);
+}
+
+static void check_simple(unsigned int *in, unsigned int *coded, unsigned int *out, int n, int dist) {
+  int words, used;
+
+  // The original Simple16 format takes integers below 2^28.
+  fill(in, n, dist, (1u << 28) - 1);
+  words = s16_compress(in, coded, n);
+  used = s16_decompress(coded, out, n);
+  expect(used == words && same(in, out, n), "s16_compress", dist, 0, 0, n);
+
+  fill_sorted(in, n, dist, (1u << 28) - 1);
+  words = s16_compress_sorted(in, coded, n);
+  used = s16_decompress_sorted(coded, out, n);
+  expect(used == words && same(in, out, n), "s16_compress_sorted", dist, 0, PFOR_SORTED, n);
+
+  fill(in, n, dist, 0xFFFFFFFFu);
+  words = s16_compress_esc(in, coded, n);
+  used = s16_decompress_esc(coded, out, n);
+  expect(used == words && same(in, out, n), "s16_compress_esc", dist, 0, 0, n);
+
+  fill_sorted(in, n, dist, 0xFFFFFFFFu);
+  words = s16_compress_esc_sorted(in, coded, n);
+  used = s16_decompress_esc_sorted(coded, out, n);
+  expect(used == words && same(in, out, n), "s16_compress_esc_sorted", dist, 0, PFOR_SORTED, n);
+
+  fill(in, n, dist, 0xFFFFFFFFu);
+  words = s8b_compress(in, (unsigned long long *) coded, n);
+  used = s8b_decompress((unsigned long long *) coded, out, n);
+  expect(used == words && same(in, out, n), "s8b_compress", dist, 0, 0, n);
+
+  fill_sorted(in, n, dist, 0xFFFFFFFFu);
+  words = s8b_compress_sorted(in, (unsigned long long *) coded, n);
+  used = s8b_decompress_sorted((unsigned long long *) coded, out, n);
+  expect(used == words && same(in, out, n), "s8b_compress_sorted", dist, 0, PFOR_SORTED, n);
+}
+
+int main() {
+  static const int sizes[] = {1, 31, 128, 129, 1000, 4097, MAX_SIZE};
+  unsigned int *in = malloc((MAX_SIZE + 4096) * sizeof(unsigned int));
+  unsigned int *coded = malloc(4 * (MAX_SIZE + 4096) * sizeof(unsigned int));
+  unsigned int *out = malloc(4 * (MAX_SIZE + 4096) * sizeof(unsigned int));
+  int d, i;
+
+  for (d = 0; d < NUM_DISTS; d++) {
+    for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+      check_pfordelta(in, coded, out, sizes[i], d);
+      check_pfordelta64(coded, sizes[i], d);
+      check_simple(in, coded, out, sizes[i], d);
+      check_s16_64(coded, sizes[i], d);
+      check_container(in, out, sizes[i], d);
+      check_cursor(in, sizes[i], d);
+      check_intersect(in, sizes[i], d);
+    }
+    check_batch(d);
+  }
+  check_wide_blocks(in, coded, out);
+  check_max_blocks();
+  check_s16_format(out);
+  check_s16_range(in, coded);
+  printf("%d cases, %d failures\n", cases, failures);
+  free(in);
+  free(coded);
+  free(out);
+  return failures != 0;
+}
@@ -0,0 +1,38 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+#include<string.h>
+#include "codec_stats.h"
+
+#ifdef CODEC_STATS
+
+__thread struct codec_stats codec_stats_thread;
+__thread struct codec_stats codec_stats_mark;
+__thread int codec_stats_paused;
+
+int codec_stats_get(struct codec_stats *stats) {
+  *stats = codec_stats_thread;
+  return 1;
+}
+
+void codec_stats_reset(void) {
+  memset(&codec_stats_thread, 0, sizeof(codec_stats_thread));
+}
+
+#else
+
+int codec_stats_get(struct codec_stats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  return 0;
+}
+
+void codec_stats_reset(void) {
+}
+
+#endif
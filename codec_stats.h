@@ -0,0 +1,63 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Counters about how the codecs behave on the data, to tune FRAC and the block
+// size. They are only compiled in with -DCODEC_STATS, otherwise the hooks in
+// the codecs are empty and codec_stats_get() returns 0.
+// Every thread has its own counters, updated without any synchronization.
+
+#ifndef CODEC_STATS_H_
+#define CODEC_STATS_H_
+
+struct codec_stats {
+  // PForDelta, one update per compressed block
+  unsigned long pfor_blocks;              // blocks compressed
+  unsigned long pfor_b[33];               // blocks compressed with each b
+  unsigned long pfor_rejected[33];        // blocks where the first i candidate b had too many exceptions
+                                          // (the retries of the original encoder)
+  unsigned long pfor_exceptions;          // exceptions, forced ones included
+  unsigned long pfor_forced;              // exceptions forced by the distance between exceptions
+  unsigned long pfor_exception_blocks[3]; // blocks whose exceptions take 8, 16 or 32 bits (t = 0, 1, 2)
+  unsigned long pfor_exception_count[3];  // exceptions of 8, 16 and 32 bits
+  unsigned long pfor_constant;            // blocks stored as a constant (hybrid mode)
+  unsigned long pfor_s16;                 // blocks stored as Simple16 (hybrid mode), their words are counted below
+
+  // Simple16, one update per word
+  unsigned long s16_words;                // words written
+  unsigned long s16_selector[16];         // words written with each selector
+};
+
+// Copies the counters of the calling thread to 'stats'.
+// Returns 1, or 0 (and zeroes 'stats') when compiled without CODEC_STATS.
+int codec_stats_get(struct codec_stats *stats);
+
+// Sets the counters of the calling thread to zero.
+void codec_stats_reset(void);
+
+// The hybrid mode compresses a block several ways and keeps one of them, so
+// only that one is counted: CODEC_STATS_MARK saves the counters before the
+// block, CODEC_STATS_DROP goes back to them when a block is thrown away, and
+// the updates between CODEC_STATS_PAUSE(1) and CODEC_STATS_PAUSE(0) are ignored.
+#ifdef CODEC_STATS
+extern __thread struct codec_stats codec_stats_thread;
+extern __thread struct codec_stats codec_stats_mark;
+extern __thread int codec_stats_paused;
+#define CODEC_STATS_ADD(counter, n) ((void) (codec_stats_paused || (codec_stats_thread.counter += (n))))
+#define CODEC_STATS_MARK() (codec_stats_mark = codec_stats_thread)
+#define CODEC_STATS_DROP() (codec_stats_thread = codec_stats_mark)
+#define CODEC_STATS_PAUSE(paused) (codec_stats_paused = (paused))
+#else
+#define CODEC_STATS_ADD(counter, n) ((void) 0)
+#define CODEC_STATS_MARK() ((void) 0)
+#define CODEC_STATS_DROP() ((void) 0)
+#define CODEC_STATS_PAUSE(paused) ((void) 0)
+#endif
+
+#endif /* CODEC_STATS_H_ */
@@ -1,37 +1,130 @@
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<pthread.h>
 #include"pfordelta.h"
+#include"pfordelta64.h"
+#include"delta.h"
 #include"coding_policy.h"
+#include"codec_stats.h"
 
-extern int block_size;
-
-// The 'input' array size should be at least an upper multiple of 'block_size_'.
+// The leftover integers are padded to the block size in a local copy, the 'input' array is not modified.
 int compress_pfordelta(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_) {
-  int num_whole_blocks = num_input_elements / block_size_;
+  return compress_pfordelta_dir(input, output, num_input_elements, block_size_, NULL, 0);
+}
+
+int compress_pfordelta_block(unsigned int *input, unsigned int *output, int block_size_, int flags, unsigned int base) {
+  unsigned int stack[PFOR_STACK_BLOCK];
+  unsigned int *gaps = NULL;
+  unsigned int *w;
+  int n;
+
+  if (flags & PFOR_SORTED) {
+    gaps = pfor_scratch(stack, sizeof(stack), block_size_ * sizeof(unsigned int));
+    if (gaps == NULL) {
+      // The gaps are stored as they are (b = 32), in the block itself.
+      w = output + 1;
+      delta_encode(input, w, block_size_, base);
+      *output = pfor_encode(&w, w, 32, block_size_);
+      return w - output;
+    }
+    delta_encode(input, gaps, block_size_, base);
+    input = gaps;
+  }
+  if (flags & PFOR_HYBRID)
+    CODEC_STATS_MARK(); // see pfor_compress_hybrid
+  if (flags & PFOR_NEWPFD)
+    n = (flags & PFOR_OPTIMAL) ? pfor_compress_newpfd_opt(input, output, block_size_)
+                               : pfor_compress_newpfd(input, output, block_size_);
+  else
+    n = (flags & PFOR_OPTIMAL) ? pfor_compress_opt(input, output, block_size_)
+                               : pfor_compress(input, output, block_size_);
+  if (flags & PFOR_HYBRID)
+    n = pfor_compress_hybrid(input, output, block_size_, n);
+  if (gaps != NULL)
+    pfor_scratch_free(gaps, stack);
+  return n;
+}
+
+// Records where block 'block' starts and its first and last integers.
+static void set_entry(struct block_entry *dir, int block, unsigned int offset, unsigned int *input, int num_elements) {
+  dir[block].offset = offset;
+  dir[block].first = input[0];
+  dir[block].last = input[num_elements - 1];
+}
+
+// Sorted mode, see compress_pfordelta_sorted. The last block is padded
+// repeating its last integer, so the padding is a run of zero gaps.
+static int compress_sorted(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_, struct block_entry *dir, int flags) {
+  unsigned int stack[PFOR_STACK_BLOCK];
+  unsigned int *pad;
+  unsigned int base = 0;
+  int encoded_offset = 0;
+  int unencoded_offset;
+  int block, left, i;
+
+  for (block = 0, unencoded_offset = 0; unencoded_offset < num_input_elements; block++, unencoded_offset += block_size_) {
+    left = num_input_elements - unencoded_offset;
+    if (dir != NULL)
+      set_entry(dir, block, encoded_offset, input + unencoded_offset, (left < block_size_) ? left : block_size_);
+
+    if (left < block_size_) {
+      if ((pad = pfor_scratch(stack, sizeof(stack), block_size_ * sizeof(unsigned int))) == NULL)
+        return -1;
+      for (i = 0; i < block_size_; i++)
+        pad[i] = input[unencoded_offset + ((i < left) ? i : left - 1)];
+      encoded_offset += compress_pfordelta_block(pad, output + encoded_offset, block_size_, flags, base);
+      pfor_scratch_free(pad, stack);
+    } else {
+      encoded_offset += compress_pfordelta_block(input + unencoded_offset, output + encoded_offset, block_size_, flags, base);
+      base = input[unencoded_offset + block_size_ - 1];
+    }
+  }
+
+  return encoded_offset;
+}
+
+// Same as compress_pfordelta, also filling the block directory 'dir' when it is not NULL.
+// 'flags' can be PFOR_SORTED, PFOR_NEWPFD, PFOR_OPTIMAL and PFOR_HYBRID.
+int compress_pfordelta_dir(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_, struct block_entry *dir, int flags) {
+  int num_whole_blocks;
   int encoded_offset = 0;
   int unencoded_offset = 0;
+  int block = 0;
 
   int left_to_encode;
-  int pad_until;
+  unsigned int stack[PFOR_STACK_BLOCK];
+  unsigned int *pad;
   int i;
 
-  block_size = block_size_;
+  if (!PFOR_VALID_BLOCK_SIZE(block_size_))
+    return -1;
+  num_whole_blocks = num_input_elements / block_size_;
+  if (flags & PFOR_SORTED)
+    return compress_sorted(input, output, num_input_elements, block_size_, dir, flags);
 
   while (num_whole_blocks-- > 0) {
-    encoded_offset += pfor_compress(input + unencoded_offset, output + encoded_offset, block_size_);
+    if (dir != NULL)
+      set_entry(dir, block++, encoded_offset, input + unencoded_offset, block_size_);
+    encoded_offset += compress_pfordelta_block(input + unencoded_offset, output + encoded_offset, block_size_, flags, 0);
     unencoded_offset += block_size_;
   }
 
   left_to_encode = num_input_elements % block_size_;
   if (left_to_encode != 0) {
-    // Encode leftover portion with a blockwise coder, and pad it to the blocksize.
-    // Assumption here is that the 'input' array size is at least an upper multiple of 'block_size_'.
-    pad_until = block_size_ * ((num_input_elements / block_size_) + 1);
+    if (dir != NULL)
+      set_entry(dir, block++, encoded_offset, input + unencoded_offset, left_to_encode);
 
-    for (i = num_input_elements; i < pad_until; ++i) {
-      input[i] = 0;
+    // Encode leftover portion with a blockwise coder, padded to the blocksize in a local copy.
+    if ((pad = pfor_scratch(stack, sizeof(stack), block_size_ * sizeof(unsigned int))) == NULL)
+      return -1;
+    for (i = 0; i < block_size_; ++i) {
+      pad[i] = (i < left_to_encode) ? input[unencoded_offset + i] : 0;
     }
-    encoded_offset += pfor_compress(input + unencoded_offset, output + encoded_offset, block_size_);
+    encoded_offset += compress_pfordelta_block(pad, output + encoded_offset, block_size_, flags, 0);
     unencoded_offset += block_size_;
+    pfor_scratch_free(pad, stack);
   }
 
   return encoded_offset;
@@ -45,8 +138,6 @@ int decompress_pfordelta(unsigned int* input, unsigned int* output, int num_inpu
   int unencoded_offset = 0;
   int left_to_encode;
 
-  block_size = _block_size;
-
   //printf("num_input_elements: %d\n", num_input_elements);
   while (num_whole_blocks-- > 0) {
     encoded_offset += pfor_decompress(input + encoded_offset, output + unencoded_offset, _block_size);
@@ -63,3 +154,306 @@ int decompress_pfordelta(unsigned int* input, unsigned int* output, int num_inpu
 
   return encoded_offset;
 }
+
+
+// Compresses a sorted array storing the differences between consecutive
+// integers. Unlike compress_pfordelta, the 'input' array is not modified.
+int compress_pfordelta_sorted(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_) {
+  return compress_pfordelta_dir(input, output, num_input_elements, block_size_, NULL, PFOR_SORTED);
+}
+
+// The 'output' array size should be at least an upper multiple of 'block_size_'.
+int decompress_pfordelta_sorted(unsigned int* input, unsigned int* output, int num_input_elements, int _block_size) {
+  unsigned int *tmp = input;
+  unsigned int base = 0;
+  int unencoded_offset;
+
+  for (unencoded_offset = 0; unencoded_offset < num_input_elements; unencoded_offset += _block_size) {
+    tmp += pfor_decompress_sorted(tmp, output + unencoded_offset, _block_size, base);
+    base = output[unencoded_offset + _block_size - 1];
+  }
+
+  return tmp - input;
+}
+
+// 64-bit version of compress_pfordelta_dir without directory, the last block
+// is padded in a local copy as in the 32-bit one.
+int compress_pfordelta64(unsigned long long *input, unsigned int *output, int num_input_elements, int block_size_, int flags) {
+  unsigned long long stack[PFOR_STACK_BLOCK];
+  unsigned long long *pad = NULL;
+  unsigned long long base = 0;
+  unsigned long long *in;
+  int encoded_offset = 0;
+  int unencoded_offset, left, i;
+
+  if (!PFOR_VALID_BLOCK_SIZE(block_size_))
+    return -1;
+  for (unencoded_offset = 0; unencoded_offset < num_input_elements; unencoded_offset += block_size_) {
+    in = input + unencoded_offset;
+    left = num_input_elements - unencoded_offset;
+    if (left < block_size_) {
+      if ((pad = pfor_scratch(stack, sizeof(stack), block_size_ * sizeof(unsigned long long))) == NULL)
+        return -1;
+      for (i = 0; i < block_size_; i++)
+        pad[i] = (i < left) ? in[i] : ((flags & PFOR_SORTED) ? in[left - 1] : 0);
+      in = pad;
+    }
+    if (flags & PFOR_SORTED) {
+      encoded_offset += pfor64_compress_sorted(in, output + encoded_offset, block_size_, base, flags & PFOR_OPTIMAL);
+      base = in[block_size_ - 1];
+    } else if (flags & PFOR_OPTIMAL) {
+      encoded_offset += pfor64_compress_opt(in, output + encoded_offset, block_size_);
+    } else {
+      encoded_offset += pfor64_compress(in, output + encoded_offset, block_size_);
+    }
+  }
+
+  if (pad != NULL)
+    pfor_scratch_free(pad, stack);
+  return encoded_offset;
+}
+
+// The 'output' array size should be at least an upper multiple of 'block_size_'.
+int decompress_pfordelta64(unsigned int *input, unsigned long long *output, int num_input_elements, int block_size_, int flags) {
+  unsigned int *tmp = input;
+  unsigned long long base = 0;
+  int unencoded_offset;
+
+  for (unencoded_offset = 0; unencoded_offset < num_input_elements; unencoded_offset += block_size_) {
+    if (flags & PFOR_SORTED) {
+      tmp += pfor64_decompress_sorted(tmp, output + unencoded_offset, block_size_, base);
+      base = output[unencoded_offset + block_size_ - 1];
+    } else {
+      tmp += pfor64_decompress(tmp, output + unencoded_offset, block_size_);
+    }
+  }
+
+  return tmp - input;
+}
+
+// Decodes block 'block' of a stream compressed with compress_pfordelta_dir.
+// The 'output' array must have room for 'block_size_' integers.
+// Returns the number of 32-bits words of the block.
+int decompress_pfordelta_block(unsigned int *input, struct block_entry *dir, int block, unsigned int *output, int block_size_, int flags) {
+  if (flags & PFOR_SORTED)
+    return pfor_decompress_sorted(input + dir[block].offset, output, block_size_, (block > 0) ? dir[block - 1].last : 0);
+  return pfor_decompress(input + dir[block].offset, output, block_size_);
+}
+
+// Decodes 'num_blocks' consecutive blocks starting at 'first_block'.
+// The 'output' array must have room for num_blocks * block_size_ integers.
+// Returns the number of 32-bits words consumed.
+int decompress_pfordelta_range(unsigned int *input, struct block_entry *dir, int first_block, int num_blocks, unsigned int *output, int block_size_, int flags) {
+  unsigned int *tmp = input + dir[first_block].offset;
+  unsigned int base = (first_block > 0) ? dir[first_block - 1].last : 0;
+
+  while (num_blocks-- > 0) {
+    if (flags & PFOR_SORTED) {
+      tmp += pfor_decompress_sorted(tmp, output, block_size_, base);
+      base = output[block_size_ - 1];
+    } else {
+      tmp += pfor_decompress(tmp, output, block_size_);
+    }
+    output += block_size_;
+  }
+
+  return tmp - (input + dir[first_block].offset);
+}
+
+////
+// Block-parallel versions. Every PForDelta block is independent, so the
+// blocks are split in one contiguous range per thread. When compressing, each
+// thread encodes its range into a private buffer recording the size of every
+// block, a prefix sum over those sizes gives the offset of each range in the
+// output and the block directory, and then each thread copies its range
+// there. The result is the same stream and directory compress_pfordelta_dir
+// produces. When decompressing, the directory gives where each range starts.
+
+struct pfor_job {
+  unsigned int *input;   // first integer of the range
+  unsigned int *output;  // compressed words of the range
+  unsigned int *sizes;   // words of each block (compression only)
+  unsigned int *pad;     // room for a padded last block (compression only)
+  struct block_entry *dir;
+  int first_block;
+  int num_blocks;
+  int block_size;
+  int flags;
+  int num_elements;      // integers of the range, the last block may be partial
+  int words;             // words produced/consumed by the range
+};
+
+static void *compress_range(void *arg) {
+  struct pfor_job *job = (struct pfor_job *) arg;
+  unsigned int *pad = job->pad;
+  unsigned int *in = job->input;
+  unsigned int *out = job->output;
+  unsigned int base = ((job->flags & PFOR_SORTED) && (job->first_block > 0)) ? in[-1] : 0;
+  int left = job->num_elements;
+  int i, n;
+
+  for (i = 0; i < job->num_blocks; i++, in += job->block_size, left -= job->block_size) {
+    if (job->dir != NULL)
+      set_entry(job->dir, job->first_block + i, 0, in, (left < job->block_size) ? left : job->block_size);
+    if (left < job->block_size) {
+      // Same padding as compress_pfordelta_dir, without touching the input.
+      for (n = 0; n < job->block_size; n++)
+        pad[n] = (n < left) ? in[n] : ((job->flags & PFOR_SORTED) ? in[left - 1] : 0);
+      in = pad;
+    }
+    n = compress_pfordelta_block(in, out, job->block_size, job->flags, base);
+    job->sizes[job->first_block + i] = n;
+    base = in[job->block_size - 1];
+    out += n;
+  }
+
+  job->words = out - job->output;
+  return NULL;
+}
+
+static void *copy_range(void *arg) {
+  struct pfor_job *job = (struct pfor_job *) arg;
+  memcpy(job->output, job->input, job->words * sizeof(unsigned int));
+  return NULL;
+}
+
+static void *decompress_range(void *arg) {
+  struct pfor_job *job = (struct pfor_job *) arg;
+
+  job->words = decompress_pfordelta_range(job->input, job->dir, job->first_block, job->num_blocks,
+                                          job->output, job->block_size, job->flags);
+  return NULL;
+}
+
+// Runs 'fn' on each job, one thread per job. Once a thread cannot be
+// created, the jobs left run one after the other in the calling thread.
+static void run_jobs(struct pfor_job *jobs, int num_threads, void *(*fn)(void *)) {
+  pthread_t threads[num_threads];
+  int started = 1; // jobs running in their own thread, the first one included
+  int i;
+
+  while ((started < num_threads) && (pthread_create(&threads[started], NULL, fn, &jobs[started]) == 0))
+    started++;
+  fn(&jobs[0]);
+  for (i = started; i < num_threads; i++)
+    fn(&jobs[i]);
+  for (i = 1; i < started; i++)
+    pthread_join(threads[i], NULL);
+}
+
+// Splits num_blocks in num_threads ranges of consecutive blocks.
+static void plan_jobs(struct pfor_job *jobs, int num_threads, int num_blocks, int block_size, int flags) {
+  int i, first;
+
+  for (i = 0, first = 0; i < num_threads; i++) {
+    jobs[i].first_block = first;
+    jobs[i].num_blocks = num_blocks / num_threads + ((i < num_blocks % num_threads) ? 1 : 0);
+    jobs[i].block_size = block_size;
+    jobs[i].flags = flags;
+    first += jobs[i].num_blocks;
+  }
+}
+
+static int threads_for(int num_threads, int num_blocks) {
+  if (num_threads <= 0)
+    num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_threads > num_blocks)
+    num_threads = num_blocks;
+  return (num_threads < 1) ? 1 : num_threads;
+}
+
+// Same output as compress_pfordelta_dir, falling back to it when there is
+// only one thread or the buffers cannot be allocated.
+// A 'num_threads' <= 0 uses one thread per online CPU.
+int compress_pfordelta_mt(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_, struct block_entry *dir, int flags, int num_threads) {
+  int num_blocks;
+  struct pfor_job *jobs;
+  unsigned int *sizes;
+  unsigned int *buffer;
+  int i, j, offset;
+
+  if (!PFOR_VALID_BLOCK_SIZE(block_size_))
+    return -1;
+  num_blocks = (num_input_elements + block_size_ - 1) / block_size_;
+  num_threads = threads_for(num_threads, num_blocks);
+  if (num_threads == 1)
+    return compress_pfordelta_dir(input, output, num_input_elements, block_size_, dir, flags);
+
+  jobs = malloc(num_threads * sizeof(struct pfor_job));
+  sizes = malloc(num_blocks * sizeof(unsigned int));
+  // A block never takes more than its header plus 'block_size_' words; the
+  // last 'block_size_' words are the padded copy of the last block.
+  buffer = malloc(((size_t) num_blocks * (block_size_ + 1) + block_size_) * sizeof(unsigned int));
+  if ((jobs == NULL) || (sizes == NULL) || (buffer == NULL)) {
+    free(buffer);
+    free(sizes);
+    free(jobs);
+    return compress_pfordelta_dir(input, output, num_input_elements, block_size_, dir, flags);
+  }
+
+  plan_jobs(jobs, num_threads, num_blocks, block_size_, flags);
+  for (i = 0; i < num_threads; i++) {
+    jobs[i].input = input + jobs[i].first_block * block_size_;
+    jobs[i].output = buffer + (size_t) jobs[i].first_block * (block_size_ + 1);
+    jobs[i].sizes = sizes;
+    jobs[i].pad = buffer + (size_t) num_blocks * (block_size_ + 1);
+    jobs[i].dir = dir;
+    jobs[i].num_elements = num_input_elements - jobs[i].first_block * block_size_;
+    if (jobs[i].num_elements > jobs[i].num_blocks * block_size_)
+      jobs[i].num_elements = jobs[i].num_blocks * block_size_;
+  }
+  run_jobs(jobs, num_threads, compress_range);
+
+  // Prefix sum over the block sizes gives where each range and block starts in 'output'.
+  for (i = 0, j = 0, offset = 0; i < num_threads; i++) {
+    jobs[i].input = jobs[i].output;
+    jobs[i].output = output + offset;
+    for (; j < jobs[i].first_block + jobs[i].num_blocks; j++) {
+      if (dir != NULL)
+        dir[j].offset = offset;
+      offset += sizes[j];
+    }
+  }
+  run_jobs(jobs, num_threads, copy_range);
+
+  free(buffer);
+  free(sizes);
+  free(jobs);
+  return offset;
+}
+
+// Same as decompress_pfordelta (or decompress_pfordelta_sorted with PFOR_SORTED
+// in 'flags'), each thread starting at its range with the directory 'dir'.
+int decompress_pfordelta_mt(unsigned int* input, struct block_entry *dir, unsigned int* output, int num_input_elements, int _block_size, int flags, int num_threads) {
+  int num_blocks = (num_input_elements + _block_size - 1) / _block_size;
+  struct pfor_job *jobs;
+  int i, words;
+
+  num_threads = threads_for(num_threads, num_blocks);
+  jobs = (num_threads > 1) ? malloc(num_threads * sizeof(struct pfor_job)) : NULL;
+  if (jobs == NULL)
+    return decompress_pfordelta_range(input, dir, 0, num_blocks, output, _block_size, flags);
+
+  plan_jobs(jobs, num_threads, num_blocks, _block_size, flags);
+  for (i = 0; i < num_threads; i++) {
+    jobs[i].input = input;
+    jobs[i].output = output + jobs[i].first_block * _block_size;
+    jobs[i].dir = dir;
+  }
+  run_jobs(jobs, num_threads, decompress_range);
+
+  i = num_threads - 1;
+  words = dir[jobs[i].first_block].offset + jobs[i].words;
+  free(jobs);
+  return words;
+}
+
+// Fills 'offsets' with the word offset of each block in 'input', plus the
+// total number of words in offsets[num_blocks].
+void pfor_block_offsets(unsigned int *input, int num_blocks, int block_size_, unsigned int *offsets) {
+  int i;
+
+  offsets[0] = 0;
+  for (i = 0; i < num_blocks; i++)
+    offsets[i + 1] = offsets[i] + pfor_skip(input + offsets[i], block_size_);
+}
@@ -1,11 +1,78 @@
 #ifndef CODING_POLICY_H_
 #define CODING_POLICY_H_
 
-// The 'input' array size should be at least an upper multiple of 'BLOCK_SIZE'.
+// Entry of the block directory, an optional side index that allows to decode
+// any block of a compressed stream without decoding the previous ones.
+// A stream of n integers has (n + block_size - 1) / block_size entries.
+struct block_entry {
+  unsigned int offset; // word offset of the block in the compressed stream
+  unsigned int first;  // first integer of the block
+  unsigned int last;   // last integer of the block, padding not included
+};
+
+// The 'input' array is not modified, the last block is padded with 0s in a local copy.
+// The block size must be a multiple of 32 up to PFOR_MAX_BLOCK_SIZE (see pfordelta.h); the
+// compressors of whole arrays return -1 on any other, or if the padded copy cannot be allocated.
 int compress_pfordelta(unsigned int *input, unsigned int *output, int num_input_elements, int _block_size);
 
 // The 'output' array size should be at least an upper multiple of 'block_size_'.
 int decompress_pfordelta(unsigned int* input, unsigned int* output, int num_input_elements, int _block_size);
 
+// Sorted mode: the input is a sorted (non-decreasing) array and the blocks store
+// the differences between consecutive integers. The decoder adds them up
+// block by block, so it returns the original integers in one pass.
+#define PFOR_SORTED 1
+
+// NewPFD format: the exception positions are stored in their own array
+// instead of a chain, see pfor_compress_newpfd. The decoders read both
+// formats, this flag only matters to the encoders.
+#define PFOR_NEWPFD 2
+
+// Optimal compression level (OptPFD): each block is compressed with the b that
+// gives the smallest size, instead of the smallest b leaving at most 10% of
+// exceptions. Encoding is slower. The format and decoder are the same, but on
+// skewed data the classic blocks may get more exceptions to patch; building
+// with -DPFOR_EXCEPTION_COST=bits charges each one, see pfor_select_opt.
+#define PFOR_OPTIMAL 4
+
+// Hybrid mode: each block is stored as a constant block, plain bit packing,
+// PForDelta (in the format of the other flags) or Simple16, whichever is
+// smallest, see pfor_compress_hybrid. Encoding is slower; the decoders read
+// every kind, this flag only matters to the encoders.
+#define PFOR_HYBRID 8
+
+// Compresses one block of 'block_size_' integers in the format given by 'flags'
+// (PFOR_SORTED, PFOR_NEWPFD, PFOR_OPTIMAL, PFOR_HYBRID). 'base' is the integer before the block in sorted mode.
+// Returns the 32-bits words used.
+int compress_pfordelta_block(unsigned int *input, unsigned int *output, int block_size_, int flags, unsigned int base);
+
+// Compress/decompress a sorted array, the 'input' array is not modified.
+int compress_pfordelta_sorted(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_);
+int decompress_pfordelta_sorted(unsigned int* input, unsigned int* output, int num_input_elements, int _block_size);
+
+// Same as compress_pfordelta (or compress_pfordelta_sorted with PFOR_SORTED in 'flags',
+// PFOR_NEWPFD selects the NewPFD format, PFOR_OPTIMAL the optimal level, PFOR_HYBRID the hybrid mode), also filling the block directory 'dir' when it is not NULL.
+int compress_pfordelta_dir(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_, struct block_entry *dir, int flags);
+
+// Decode one block, or 'num_blocks' consecutive blocks, using the directory.
+// The 'flags' must be the ones given to compress_pfordelta_dir.
+// The 'output' array size should be a multiple of 'block_size_'. They return the 32-bits words consumed.
+int decompress_pfordelta_block(unsigned int *input, struct block_entry *dir, int block, unsigned int *output, int block_size_, int flags);
+int decompress_pfordelta_range(unsigned int *input, struct block_entry *dir, int first_block, int num_blocks, unsigned int *output, int block_size_, int flags);
+
+// 64-bit integers, see pfordelta64.h. 'flags' can be PFOR_SORTED and PFOR_OPTIMAL.
+// The 'output' array of decompress_pfordelta64 should be at least an upper multiple of 'block_size_'.
+int compress_pfordelta64(unsigned long long *input, unsigned int *output, int num_input_elements, int block_size_, int flags);
+int decompress_pfordelta64(unsigned int *input, unsigned long long *output, int num_input_elements, int block_size_, int flags);
+
+// Block-parallel versions, they produce/read the same stream and directory as compress_pfordelta_dir.
+// The encoder fills 'dir' when it is not NULL, the decoder needs it to start each thread at its blocks.
+// 'num_threads' <= 0 uses one thread per online CPU.
+int compress_pfordelta_mt(unsigned int *input, unsigned int *output, int num_input_elements, int block_size_, struct block_entry *dir, int flags, int num_threads);
+int decompress_pfordelta_mt(unsigned int* input, struct block_entry *dir, unsigned int* output, int num_input_elements, int _block_size, int flags, int num_threads);
+
+// Word offset of each block in a compressed stream, offsets[num_blocks] is the total size.
+// The 'offsets' array needs num_blocks + 1 entries.
+void pfor_block_offsets(unsigned int *input, int num_blocks, int block_size_, unsigned int *offsets);
 
 #endif /* CODING_POLICY_H_ */
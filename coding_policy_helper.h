@@ -35,7 +35,8 @@
 #define CODING_POLICY_HELPER_H_
 
 // Determines the size of the input buffer that will be compressed.
-// It needs to be a multiple of the block size for when we use blockwise codings, because we need to pad the input buffer with 0s until the block size.
+// It used to be needed for blockwise codings, which padded the input buffer with 0s until the block size; compress_pfordelta now pads a local copy,
+// so it is only kept for code that still rounds its buffers up to the block size.
 // If the block size is 0, we have a non-blockwise coder, and don't need an upperbound.
 #define UncompressedInBufferUpperbound(buffer_size, block_size) ((((block_size) == 0) || ((buffer_size) % (block_size) == 0)) ? (buffer_size) : ((((buffer_size) / (block_size)) + 1) * (block_size)))
 
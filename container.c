@@ -0,0 +1,221 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include "pfordelta.h"
+#include "s16.h"
+#include "delta.h"
+#include "container.h"
+
+#define ALIGN64(x) (((x) + 63) & ~63ULL)
+
+// Compresses one block of 'len' integers into 'out', returns the words used.
+static int encode_block(unsigned int *in, int len, unsigned int *out, unsigned int *tmp,
+                        int codec, int block_size, int flags, unsigned int base) {
+  int i;
+
+  if ((codec == CODEC_S16) || (codec == CODEC_S16_ESC)) {
+    if (flags & PFOR_SORTED) {
+      delta_encode(in, tmp, len, base);
+      in = tmp;
+    }
+    return (codec == CODEC_S16) ? s16_compress(in, out, len) : s16_compress_esc(in, out, len);
+  }
+
+  if (len < block_size) {
+    // Same padding as compress_pfordelta: 0s, or zero gaps in sorted mode.
+    for (i = 0; i < block_size; i++)
+      tmp[i] = (i < len) ? in[i] : ((flags & PFOR_SORTED) ? in[len - 1] : 0);
+    in = tmp;
+  }
+  return compress_pfordelta_block(in, out, block_size, flags, base);
+}
+
+// Largest block 'codec' can write: a PForDelta block takes at most one word
+// per integer plus its header, Simple16 one word per integer, or two for an
+// escaped one.
+static int max_block_words(int codec, int block_size) {
+  if (codec == CODEC_S16_ESC)
+    return 2 * block_size;
+  if (codec == CODEC_S16)
+    return block_size;
+  return block_size + 1;
+}
+
+// Whether CODEC_S16 can hold 'input': every integer, or every gap with
+// PFOR_SORTED, is below 2^28.
+static int s16_fits(unsigned int *input, long num_elements, int flags) {
+  unsigned int prev = 0;
+  long i;
+
+  for (i = 0; i < num_elements; i++) {
+    if (((flags & PFOR_SORTED) ? input[i] - prev : input[i]) >= (1u << 28))
+      return 0;
+    prev = input[i];
+  }
+  return 1;
+}
+
+int container_write(const char *path, unsigned int *input, long num_elements, int codec, int block_size, int flags) {
+  struct container_header h;
+  struct block_entry *dir = NULL;
+  unsigned int *out = NULL;
+  unsigned int *tmp = NULL;
+  FILE *f = NULL;
+  unsigned int base = 0;
+  long start;
+  int block, len, n;
+  int ret = -1;
+
+  if (((codec != CODEC_PFORDELTA) && (codec != CODEC_S16) && (codec != CODEC_S16_ESC)) || (block_size <= 0) || (num_elements < 0) ||
+      ((codec == CODEC_PFORDELTA) && !PFOR_VALID_BLOCK_SIZE(block_size)) ||
+      ((codec == CODEC_S16) && !s16_fits(input, num_elements, flags))) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(&h, 0, sizeof(h));
+  h.magic = CONTAINER_MAGIC;
+  h.version = CONTAINER_VERSION;
+  h.codec = codec;
+  h.flags = flags;
+  h.block_size = block_size;
+  h.num_blocks = (num_elements + block_size - 1) / block_size;
+  h.num_elements = num_elements;
+  h.dir_offset = sizeof(h);
+  h.data_offset = ALIGN64(h.dir_offset + (unsigned long long) h.num_blocks * sizeof(struct block_entry));
+
+  dir = malloc((h.num_blocks + 1) * sizeof(struct block_entry));
+  out = malloc(max_block_words(codec, block_size) * sizeof(unsigned int));
+  tmp = malloc(block_size * sizeof(unsigned int));
+  f = fopen(path, "wb");
+  if ((dir == NULL) || (out == NULL) || (tmp == NULL) || (f == NULL))
+    goto done;
+
+  // The directory is written at the end, once the offsets are known.
+  if (fseek(f, h.data_offset, SEEK_SET) != 0)
+    goto done;
+
+  for (block = 0, start = 0; start < num_elements; block++, start += block_size) {
+    len = (num_elements - start < block_size) ? num_elements - start : block_size;
+    dir[block].offset = h.data_words;
+    dir[block].first = input[start];
+    dir[block].last = input[start + len - 1];
+    n = encode_block(input + start, len, out, tmp, codec, block_size, flags, base);
+    if (fwrite(out, sizeof(unsigned int), n, f) != (size_t) n)
+      goto done;
+    h.data_words += n;
+    base = dir[block].last;
+  }
+
+  if ((fseek(f, 0, SEEK_SET) != 0) ||
+      (fwrite(&h, sizeof(h), 1, f) != 1) ||
+      (fwrite(dir, sizeof(struct block_entry), h.num_blocks, f) != h.num_blocks))
+    goto done;
+  ret = 0;
+
+done:
+  if ((f != NULL) && (fclose(f) != 0))
+    ret = -1;
+  free(dir);
+  free(out);
+  free(tmp);
+  return ret;
+}
+
+int container_open(struct container *c, const char *path) {
+  const struct container_header *h;
+  struct stat st;
+  int fd;
+
+  memset(c, 0, sizeof(struct container));
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(struct container_header))) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+
+  c->map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (c->map == MAP_FAILED) {
+    c->map = NULL;
+    return -1;
+  }
+  c->map_size = st.st_size;
+
+  h = (const struct container_header *) c->map;
+  if ((h->magic != CONTAINER_MAGIC) || (h->version != CONTAINER_VERSION) ||
+      ((h->codec != CODEC_PFORDELTA) && (h->codec != CODEC_S16) && (h->codec != CODEC_S16_ESC)) || (h->block_size == 0) ||
+      ((h->codec == CODEC_PFORDELTA) && !PFOR_VALID_BLOCK_SIZE(h->block_size)) ||
+      (h->num_blocks != (h->num_elements + h->block_size - 1) / h->block_size) ||
+      (h->dir_offset + (unsigned long long) h->num_blocks * sizeof(struct block_entry) > h->data_offset) ||
+      (h->data_offset + h->data_words * sizeof(unsigned int) > c->map_size)) {
+    container_close(c);
+    errno = EINVAL;
+    return -1;
+  }
+
+  c->header = h;
+  c->dir = (const struct block_entry *) ((const char *) c->map + h->dir_offset);
+  c->data = (const unsigned int *) ((const char *) c->map + h->data_offset);
+  return 0;
+}
+
+void container_close(struct container *c) {
+  if (c->map != NULL)
+    munmap(c->map, c->map_size);
+  memset(c, 0, sizeof(struct container));
+}
+
+int block_decode(const unsigned int *data, const struct block_entry *dir, int block, long num_elements,
+                 int codec, int block_size, int flags, unsigned int *output) {
+  unsigned int *in = (unsigned int *) (data + dir[block].offset); // only read
+  unsigned int base = (block > 0) ? dir[block - 1].last : 0;
+  long start = (long) block * block_size;
+  int len = (num_elements - start < block_size) ? num_elements - start : block_size;
+
+  if ((codec == CODEC_S16) || (codec == CODEC_S16_ESC)) {
+    if (codec == CODEC_S16)
+      s16_decompress(in, output, len);
+    else
+      s16_decompress_esc(in, output, len);
+    if (flags & PFOR_SORTED)
+      delta_decode(output, len, base);
+  } else if (flags & PFOR_SORTED) {
+    pfor_decompress_sorted(in, output, block_size, base);
+  } else {
+    pfor_decompress(in, output, block_size);
+  }
+  return len;
+}
+
+int container_decode_block(const struct container *c, int block, unsigned int *output) {
+  const struct container_header *h = c->header;
+
+  return block_decode(c->data, c->dir, block, h->num_elements, h->codec, h->block_size, h->flags, output);
+}
+
+long container_decode(const struct container *c, unsigned int *output) {
+  long n = 0;
+  unsigned int block;
+
+  for (block = 0; block < c->header->num_blocks; block++)
+    n += container_decode_block(c, block, output + n);
+  return n;
+}
@@ -0,0 +1,89 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// On-disk container for a compressed integer array, made to be read straight
+// from a memory mapped file, without copying it to the heap.
+//
+// Layout (native byte order, offsets in bytes):
+//   0            struct container_header (64 bytes)
+//   64           block directory, num_blocks struct block_entry
+//   data_offset  compressed words, 64 bytes aligned
+//
+// The integers are split in blocks of block_size integers, compressed one
+// after the other with the codec of the header. The directory gives the word
+// offset of each block (relative to data_offset) and its first and last
+// integers, so any block can be decoded on its own. With PFOR_SORTED in the
+// flags the blocks store d-gaps, the first one relative to the last integer
+// of the previous block.
+
+#ifndef CONTAINER_H_
+#define CONTAINER_H_
+
+#include "coding_policy.h"
+
+#define CONTAINER_MAGIC 0x31434643 // "CFC1"
+#define CONTAINER_VERSION 1
+
+// Codecs of a container
+#define CODEC_PFORDELTA 1 // a PForDelta block per directory entry
+#define CODEC_S16 2       // block_size integers coded with Simple16 per entry, all < 2^28
+#define CODEC_S16_ESC 3   // same with the escaped Simple16 format, for any integer
+
+struct container_header {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int codec;
+  unsigned int flags;
+  unsigned int block_size;
+  unsigned int num_blocks;
+  unsigned long long num_elements;
+  unsigned long long dir_offset;
+  unsigned long long data_offset;
+  unsigned long long data_words;
+  unsigned int reserved[2];
+};
+
+// A container opened with container_open. The pointers point into the mapping.
+struct container {
+  const struct container_header *header;
+  const struct block_entry *dir;
+  const unsigned int *data;
+  void *map;
+  unsigned long long map_size;
+};
+
+// Compresses 'input' with 'codec' and writes it to 'path'. 'flags' can be PFOR_SORTED
+// (and PFOR_NEWPFD, PFOR_OPTIMAL, PFOR_HYBRID with CODEC_PFORDELTA).
+// Only one block is compressed in memory at a time. Returns 0, or -1 on error (see errno);
+// EINVAL when an argument is invalid (CODEC_PFORDELTA blocks are multiples of 32 up
+// to PFOR_MAX_BLOCK_SIZE) or, with CODEC_S16, an integer (a gap with
+// PFOR_SORTED) is >= 2^28, in which case no file is written.
+int container_write(const char *path, unsigned int *input, long num_elements, int codec, int block_size, int flags);
+
+// Maps the container in 'path' and checks its header. Returns 0, or -1 if it
+// cannot be read or it is not a valid container.
+int container_open(struct container *c, const char *path);
+void container_close(struct container *c);
+
+// Decodes block 'block' into 'output', which must have room for block_size integers.
+// Returns the number of integers of the block.
+int container_decode_block(const struct container *c, int block, unsigned int *output);
+
+// Decodes block 'block' of 'num_elements' integers compressed with the container
+// layout: 'data' points to the first word of block 0. It works on a container as
+// well as on the output of compress_pfordelta_dir (with CODEC_PFORDELTA).
+// Returns the number of integers of the block.
+int block_decode(const unsigned int *data, const struct block_entry *dir, int block, long num_elements,
+                 int codec, int block_size, int flags, unsigned int *output);
+
+// Decodes all the integers. The 'output' array size should be at least an upper multiple of block_size.
+long container_decode(const struct container *c, unsigned int *output);
+
+#endif /* CONTAINER_H_ */
@@ -0,0 +1,130 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+#include<stdlib.h>
+#include "cursor.h"
+
+// Moves to the first integer of 'block', without decoding it.
+static void enter(struct cursor *c, int block) {
+  long start = (long) block * c->block_size;
+
+  c->block = block;
+  c->pos = 0;
+  if (block < c->num_blocks) {
+    c->len = (c->num_elements - start < c->block_size) ? c->num_elements - start : c->block_size;
+    c->value = c->dir[block].first;
+  }
+}
+
+static void decode(struct cursor *c) {
+  if (c->decoded != c->block) {
+    block_decode(c->data, c->dir, c->block, c->num_elements, c->codec, c->block_size, c->flags, c->buffer);
+    c->decoded = c->block;
+  }
+}
+
+int cursor_init(struct cursor *c, const unsigned int *data, const struct block_entry *dir, long num_elements,
+                int codec, int block_size, int flags) {
+  c->data = data;
+  c->dir = dir;
+  c->num_elements = num_elements;
+  c->num_blocks = (num_elements + block_size - 1) / block_size;
+  c->codec = codec;
+  c->block_size = block_size;
+  c->flags = flags;
+  c->decoded = -1;
+  // PForDelta decodes whole blocks, padding included.
+  c->buffer = malloc(block_size * sizeof(unsigned int));
+  if (c->buffer == NULL)
+    return -1;
+  enter(c, 0);
+  return 0;
+}
+
+int cursor_open(struct cursor *c, const struct container *container) {
+  const struct container_header *h = container->header;
+
+  return cursor_init(c, container->data, container->dir, h->num_elements, h->codec, h->block_size, h->flags);
+}
+
+void cursor_close(struct cursor *c) {
+  free(c->buffer);
+  c->buffer = NULL;
+}
+
+int cursor_next(struct cursor *c) {
+  if (cursor_end(c))
+    return 0;
+  if (c->pos + 1 < c->len) {
+    decode(c);
+    c->value = c->buffer[++c->pos];
+    return 1;
+  }
+  enter(c, c->block + 1);
+  return !cursor_end(c);
+}
+
+int cursor_next_block(struct cursor *c) {
+  if (cursor_end(c))
+    return 0;
+  enter(c, c->block + 1);
+  return !cursor_end(c);
+}
+
+const unsigned int *cursor_block(struct cursor *c) {
+  decode(c);
+  return c->buffer;
+}
+
+int cursor_next_geq(struct cursor *c, unsigned int target) {
+  int lo, hi, mid, step;
+
+  if (cursor_end(c))
+    return 0;
+  if (c->value >= target)
+    return 1;
+
+  if (c->dir[c->block].last < target) {
+    // First block after the current one whose last integer is >= target,
+    // galloping as the targets are usually close to the cursor.
+    lo = c->block + 1;
+    for (step = 1; (lo + step <= c->num_blocks) && (c->dir[lo + step - 1].last < target); step *= 2)
+      lo += step;
+    hi = (lo + step < c->num_blocks) ? lo + step : c->num_blocks;
+    while (lo < hi) {
+      mid = (lo + hi) / 2;
+      if (c->dir[mid].last < target)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    enter(c, lo);
+    if (cursor_end(c))
+      return 0;
+    if (c->value >= target)
+      return 1;
+  }
+
+  // The target is inside the block, after the current position.
+  decode(c);
+  lo = c->pos + 1;
+  for (step = 1; (lo + step < c->len) && (c->buffer[lo + step - 1] < target); step *= 2)
+    lo += step;
+  hi = (lo + step < c->len) ? lo + step - 1 : c->len - 1;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (c->buffer[mid] < target)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  c->pos = lo;
+  c->value = c->buffer[lo];
+  return 1;
+}
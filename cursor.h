@@ -0,0 +1,103 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Cursor over a compressed sorted list (a posting list), for conjunctive
+// queries that only need some of its integers.
+//
+// The list is read through its block directory: cursor_next_geq skips the
+// blocks whose last integer is smaller than the target without decoding
+// them, and a block is only decoded when the cursor has to look inside it.
+// Landing on the first integer of a block does not decode it either, its
+// value is in the directory.
+//
+// Usage:
+//   struct cursor c;
+//   cursor_open(&c, &container);
+//   while (cursor_next_geq(&c, target))
+//     ... cursor_value(&c) is the first integer >= target ...
+//   cursor_close(&c);
+
+#ifndef CURSOR_H_
+#define CURSOR_H_
+
+#include "container.h"
+
+struct cursor {
+  const unsigned int *data;
+  const struct block_entry *dir;
+  long num_elements;
+  int num_blocks;
+  int codec;
+  int block_size;
+  int flags;
+  int block;          // current block, num_blocks at the end of the list
+  int pos;            // position of the current integer in the block
+  int len;            // integers in the current block
+  int decoded;        // block held in 'buffer', -1 if none
+  unsigned int value; // current integer
+  unsigned int *buffer;
+};
+
+// Places the cursor on the first integer of the list. The list must be sorted,
+// stored with the container layout (see block_decode in container.h).
+// Returns 0, or -1 if the block buffer cannot be allocated.
+int cursor_init(struct cursor *c, const unsigned int *data, const struct block_entry *dir, long num_elements,
+                int codec, int block_size, int flags);
+
+// Same as cursor_init over an opened container.
+int cursor_open(struct cursor *c, const struct container *container);
+
+void cursor_close(struct cursor *c);
+
+// Moves to the next integer. Returns 0 if the cursor was on the last one,
+// the cursor is then at the end of the list.
+int cursor_next(struct cursor *c);
+
+// Moves forward to the first integer >= 'target', it does not move if the
+// current one already is. Returns 0 if there is none (end of the list).
+int cursor_next_geq(struct cursor *c, unsigned int target);
+
+// Moves to the first integer of the next block. Returns 0 at the end of the list.
+int cursor_next_block(struct cursor *c);
+
+// Decodes the current block if it is not yet, and returns it. The current
+// integer is at cursor_pos(), the block has cursor_len() integers.
+const unsigned int *cursor_block(struct cursor *c);
+
+// Returns 1 if the cursor is at the end of the list.
+static inline int cursor_end(const struct cursor *c) {
+  return c->block >= c->num_blocks;
+}
+
+// Current integer, undefined at the end of the list.
+static inline unsigned int cursor_value(const struct cursor *c) {
+  return c->value;
+}
+
+// Position of the current integer in its block, and integers in the block.
+static inline int cursor_pos(const struct cursor *c) {
+  return c->pos;
+}
+
+static inline int cursor_len(const struct cursor *c) {
+  return c->len;
+}
+
+// Last integer of the current block, undefined at the end of the list.
+static inline unsigned int cursor_block_last(const struct cursor *c) {
+  return c->dir[c->block].last;
+}
+
+// Index of the current integer in the list.
+static inline long cursor_index(const struct cursor *c) {
+  return (long) c->block * c->block_size + c->pos;
+}
+
+#endif /* CURSOR_H_ */
@@ -0,0 +1,96 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Delta coding for sorted integer arrays.
+//
+// The prefix sum is computed four integers at a time with SSE2 (part of every
+// x86-64 CPU): two shifted additions inside the register plus the running
+// total of the previous four integers.
+//
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "delta.h"
+
+void delta_encode(unsigned int* in, unsigned int* out, int n, unsigned int base) {
+  unsigned int prev = base;
+  unsigned int x;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    x = in[i];
+    out[i] = x - prev;
+    prev = x;
+  }
+}
+
+unsigned int delta_decode(unsigned int* v, int n, unsigned int base) {
+  int i = 0;
+
+#ifdef __SSE2__
+  __m128i carry = _mm_set1_epi32(base);
+  __m128i x;
+
+  for (; i + 4 <= n; i += 4) {
+    x = _mm_loadu_si128((__m128i*) (v + i));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi32(x, carry);
+    _mm_storeu_si128((__m128i*) (v + i), x);
+    carry = _mm_shuffle_epi32(x, 0xFF);
+  }
+  base = _mm_cvtsi128_si32(carry);
+#endif
+
+  for (; i < n; i++) {
+    base += v[i];
+    v[i] = base;
+  }
+  return base;
+}
+
+void delta_encode64(unsigned long long* in, unsigned long long* out, int n, unsigned long long base) {
+  unsigned long long prev = base;
+  unsigned long long x;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    x = in[i];
+    out[i] = x - prev;
+    prev = x;
+  }
+}
+
+// Two integers per register, one shifted addition.
+unsigned long long delta_decode64(unsigned long long* v, int n, unsigned long long base) {
+  int i = 0;
+
+#ifdef __SSE2__
+  __m128i carry = _mm_set1_epi64x(base);
+  __m128i x;
+
+  for (; i + 2 <= n; i += 2) {
+    x = _mm_loadu_si128((__m128i*) (v + i));
+    x = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi64(x, carry);
+    _mm_storeu_si128((__m128i*) (v + i), x);
+    carry = _mm_unpackhi_epi64(x, x);
+  }
+  base = (unsigned long long) _mm_cvtsi128_si64(carry);
+#endif
+
+  for (; i < n; i++) {
+    base += v[i];
+    v[i] = base;
+  }
+  return base;
+}
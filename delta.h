@@ -0,0 +1,28 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Delta coding (d-gaps) for sorted integer arrays.
+// The differences are computed modulo 2^32, so any array can go through
+// delta_encode and delta_decode, but only sorted arrays give small gaps.
+
+#ifndef DELTA_H_
+#define DELTA_H_
+
+// out[i] = in[i] - in[i - 1], with in[-1] = base. 'in' and 'out' may be the same array.
+void delta_encode(unsigned int* in, unsigned int* out, int n, unsigned int base);
+
+// In place prefix sum, v[i] = base + v[0] + ... + v[i]. Returns v[n - 1] (base if n is 0).
+unsigned int delta_decode(unsigned int* v, int n, unsigned int base);
+
+// Same for 64-bit integers, modulo 2^64.
+void delta_encode64(unsigned long long* in, unsigned long long* out, int n, unsigned long long base);
+unsigned long long delta_decode64(unsigned long long* v, int n, unsigned long long base);
+
+#endif /* DELTA_H_ */
@@ -0,0 +1,252 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+#include<stdlib.h>
+#include<string.h>
+#include "intersect.h"
+
+static int intersect_scalar(const unsigned int *a, int na, const unsigned int *b, int nb, unsigned int *output) {
+  int i = 0, j = 0, k = 0;
+
+  while ((i < na) && (j < nb)) {
+    if (a[i] < b[j]) {
+      i++;
+    } else if (a[i] > b[j]) {
+      j++;
+    } else {
+      output[k++] = a[i];
+      i++;
+      j++;
+    }
+  }
+  return k;
+}
+
+static int (*intersect_kernel)(const unsigned int *, int, const unsigned int *, int, unsigned int *) = intersect_scalar;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+// Byte shuffle moving the lanes set in a 4 bits mask to the front.
+static unsigned char compact[16][16] __attribute__((aligned(16)));
+
+// Compares 4 integers of 'a' against 4 of 'b' (all rotations of b), and
+// advances the vector with the smallest maximum, as in Schlegel et al. and
+// Lemire et al. The store always writes 4 integers. A vector that stays has
+// at most 3 matches already, its largest integer is not one of them, so
+// k <= i + 3 and k <= j + 3, and the loop stops 8 integers before the end
+// of either array to leave room for the store.
+__attribute__((target("sse4.1")))
+static int intersect_sse(const unsigned int *a, int na, const unsigned int *b, int nb, unsigned int *output) {
+  __m128i va, vb, eq;
+  unsigned int amax, bmax;
+  int i = 0, j = 0, k = 0, mask;
+
+  while ((i + 8 <= na) && (j + 8 <= nb)) {
+    va = _mm_loadu_si128((const __m128i*) (a + i));
+    vb = _mm_loadu_si128((const __m128i*) (b + j));
+    eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                                   _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+                      _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                                   _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+    amax = a[i + 3];
+    bmax = b[j + 3];
+    mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+    _mm_storeu_si128((__m128i*) (output + k), _mm_shuffle_epi8(va, _mm_load_si128((const __m128i*) compact[mask])));
+    k += __builtin_popcount(mask);
+    if (amax <= bmax)
+      i += 4;
+    if (bmax <= amax)
+      j += 4;
+  }
+  return k + intersect_scalar(a + i, na - i, b + j, nb - j, output + k);
+}
+
+__attribute__((constructor))
+static void intersect_init(void) {
+  int m, l, n, t;
+
+  for (m = 0; m < 16; m++) {
+    for (l = 0, n = 0; l < 4; l++) {
+      if (m & (1 << l)) {
+        for (t = 0; t < 4; t++)
+          compact[m][4 * n + t] = 4 * l + t;
+        n++;
+      }
+    }
+    for (; n < 4; n++)
+      for (t = 0; t < 4; t++)
+        compact[m][4 * n + t] = 0x80;
+  }
+  __builtin_cpu_init();
+  if ((getenv("CODEC_SCALAR") == NULL) && __builtin_cpu_supports("sse4.1"))
+    intersect_kernel = intersect_sse;
+}
+
+#endif
+
+int intersect_blocks(const unsigned int *a, int na, const unsigned int *b, int nb, unsigned int *output) {
+  return intersect_kernel(a, na, b, nb, output);
+}
+
+// First position >= i of 'in' (of n integers) whose value is > 'x', galloping from i.
+static long gallop_gt(const unsigned int *in, long i, long n, unsigned int x) {
+  long step, hi, mid;
+
+  for (step = 1; (i + step <= n) && (in[i + step - 1] <= x); step *= 2)
+    i += step;
+  hi = (i + step < n) ? i + step : n;
+  while (i < hi) {
+    mid = (i + hi) / 2;
+    if (in[mid] <= x)
+      i = mid + 1;
+    else
+      hi = mid;
+  }
+  return i;
+}
+
+// Searches each integer of the short side with cursor_next_geq.
+static long gallop_array(struct cursor *c, const unsigned int *input, long n, unsigned int *output) {
+  long i, k = 0;
+
+  for (i = 0; i < n; i++) {
+    if (!cursor_next_geq(c, input[i]))
+      break;
+    if (cursor_value(c) == input[i])
+      output[k++] = input[i];
+  }
+  return k;
+}
+
+long intersect_array(struct cursor *c, const unsigned int *input, long n, unsigned int *output) {
+  long i = 0, j, k = 0;
+
+  if (n * INTERSECT_GALLOP_RATIO <= c->num_elements - cursor_index(c))
+    return gallop_array(c, input, n, output);
+
+  while ((i < n) && !cursor_end(c)) {
+    if (cursor_block_last(c) < input[i]) {
+      // No candidate in the rest of the block, skip to the block holding input[i].
+      if (!cursor_next_geq(c, input[i]))
+        break;
+      continue;
+    }
+    if (input[i] < cursor_value(c)) {
+      i = gallop_gt(input, i, n, cursor_value(c) - 1);
+      continue;
+    }
+    // input[i..j) falls in the rest of the block.
+    j = gallop_gt(input, i, n, cursor_block_last(c));
+    k += intersect_blocks(input + i, j - i, cursor_block(c) + cursor_pos(c),
+                          cursor_len(c) - cursor_pos(c), output + k);
+    i = j;
+    cursor_next_block(c);
+  }
+  return k;
+}
+
+long intersect(struct cursor *a, struct cursor *b, unsigned int *output) {
+  struct cursor *t;
+  long n, k = 0;
+  int na, nb;
+
+  if (a->num_elements - cursor_index(a) > b->num_elements - cursor_index(b)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+
+  if ((a->num_elements - cursor_index(a)) * INTERSECT_GALLOP_RATIO <= b->num_elements - cursor_index(b)) {
+    while (!cursor_end(a)) {
+      if (!cursor_next_geq(b, cursor_value(a)))
+        break;
+      if (cursor_value(b) == cursor_value(a))
+        output[k++] = cursor_value(a);
+      cursor_next(a);
+    }
+    return k;
+  }
+
+  while (!cursor_end(a) && !cursor_end(b)) {
+    // Skip the blocks that do not overlap, without decoding them.
+    if (cursor_block_last(a) < cursor_value(b)) {
+      cursor_next_geq(a, cursor_value(b));
+      continue;
+    }
+    if (cursor_block_last(b) < cursor_value(a)) {
+      cursor_next_geq(b, cursor_value(a));
+      continue;
+    }
+
+    na = cursor_len(a) - cursor_pos(a);
+    nb = cursor_len(b) - cursor_pos(b);
+    k += intersect_blocks(cursor_block(a) + cursor_pos(a), na, cursor_block(b) + cursor_pos(b), nb, output + k);
+
+    // Move past the block that ends first, and past its last integer in the other list.
+    if (cursor_block_last(a) > cursor_block_last(b)) {
+      t = a;
+      a = b;
+      b = t;
+    }
+    n = cursor_block_last(a);
+    cursor_next_block(a);
+    if (cursor_block_last(b) == n)
+      cursor_next_block(b);
+    else
+      cursor_next_geq(b, n + 1);
+  }
+  return k;
+}
+
+static int compare_length(const void *x, const void *y) {
+  const struct cursor *a = *(struct cursor * const *) x;
+  const struct cursor *b = *(struct cursor * const *) y;
+  long na = a->num_elements - cursor_index(a);
+  long nb = b->num_elements - cursor_index(b);
+
+  return (na > nb) - (na < nb);
+}
+
+long intersect_k(struct cursor **lists, int k, unsigned int *output) {
+  unsigned int *tmp, *in, *out, *swap;
+  long n;
+  int i;
+
+  if (k <= 0)
+    return 0;
+  qsort(lists, k, sizeof(struct cursor *), compare_length);
+  if (k == 1) {
+    for (n = 0; !cursor_end(lists[0]); cursor_next(lists[0]))
+      output[n++] = cursor_value(lists[0]);
+    return n;
+  }
+
+  n = intersect(lists[0], lists[1], output);
+  if ((k == 2) || (n == 0))
+    return n;
+
+  // The candidates go back and forth between 'output' and 'tmp'.
+  tmp = malloc(n * sizeof(unsigned int));
+  if (tmp == NULL)
+    return -1;
+  in = output;
+  out = tmp;
+  for (i = 2; (i < k) && (n > 0); i++) {
+    n = intersect_array(lists[i], in, n, out);
+    swap = in;
+    in = out;
+    out = swap;
+  }
+  if (in != output)
+    memcpy(output, in, n * sizeof(unsigned int));
+  free(tmp);
+  return n;
+}
@@ -0,0 +1,48 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Intersection of compressed posting lists, strictly increasing lists read
+// through a cursor (see cursor.h).
+//
+// The lists are merged block by block: a block is skipped through the
+// directory when its range [first, last] does not overlap the other list,
+// otherwise it is decoded and intersected with the overlapping part of the
+// other one with SSE4.1 (four by four comparisons), if the CPU has it.
+// When a list is much shorter than the other, INTERSECT_GALLOP_RATIO times
+// or more, each of its integers is searched with cursor_next_geq instead,
+// which gallops over the directory and inside the blocks.
+
+#ifndef INTERSECT_H_
+#define INTERSECT_H_
+
+#include "cursor.h"
+
+#define INTERSECT_GALLOP_RATIO 32
+
+// Intersects the lists of 'a' and 'b' from their current positions, the
+// cursors are consumed. The 'output' array needs room for the length of the shortest list.
+// Returns the number of integers written.
+long intersect(struct cursor *a, struct cursor *b, unsigned int *output);
+
+// Intersects the sorted array 'input' with the list of 'c', 'output' must not overlap it.
+// Returns the number of integers written.
+long intersect_array(struct cursor *c, const unsigned int *input, long n, unsigned int *output);
+
+// Intersects 'k' lists, starting with the shortest ones. The order of 'lists' is changed.
+// The 'output' array needs room for the length of the shortest list.
+// Returns the number of integers written, or -1 if the buffer for more than
+// two lists cannot be allocated.
+long intersect_k(struct cursor **lists, int k, unsigned int *output);
+
+// Intersects two strictly increasing arrays into 'output', which must not overlap them
+// and needs room for the shortest one. Returns the number of integers written.
+int intersect_blocks(const unsigned int *a, int na, const unsigned int *b, int nb, unsigned int *output);
+
+#endif /* INTERSECT_H_ */
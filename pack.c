@@ -42,11 +42,98 @@
 
 #include "pack.h"
 
+//
+// Packs the 32 integers of 'v' into the 'b' words of 'w', overwriting them.
+// It is inlined with a constant b in each packN below, so the loop is fully
+// unrolled and every shift and word index is a constant, as in unpackN.
+static inline __attribute__((always_inline))
+void pack_chunk(const unsigned int* v, unsigned int* w, const int b) {
+  unsigned int acc = 0;
+  int i, bp, s;
+
+#pragma GCC unroll 32
+  for (bp = 0, i = 0; i < 32; i++, bp += b) {
+    s = 32 - b - (bp & 31);
+    if (s > 0) {
+      acc |= v[i] << s;
+    } else if (s == 0) {
+      w[bp >> 5] = acc | v[i];
+      acc = 0;
+    } else {
+      w[bp >> 5] = acc | (v[i] >> -s);
+      acc = v[i] << (32 + s);
+    }
+  }
+}
+
+#define PACK(n)                                                   \
+  void pack##n(unsigned int* v, unsigned int* w, int BS) {        \
+    int i;                                                        \
+    for (i = 0; i < BS; i += 32, v += 32, w += n)                 \
+      pack_chunk(v, w, n);                                        \
+  }
+
+void pack0(unsigned int* v, unsigned int* w, int BS) {
+}
+
+PACK(1)
+PACK(2)
+PACK(3)
+PACK(4)
+PACK(5)
+PACK(6)
+PACK(7)
+PACK(8)
+PACK(9)
+PACK(10)
+PACK(11)
+PACK(12)
+PACK(13)
+PACK(14)
+PACK(15)
+PACK(16)
+PACK(17)
+PACK(18)
+PACK(19)
+PACK(20)
+PACK(21)
+PACK(22)
+PACK(23)
+PACK(24)
+PACK(25)
+PACK(26)
+PACK(27)
+PACK(28)
+PACK(29)
+PACK(30)
+PACK(31)
+
+void pack32(unsigned int* v, unsigned int* w, int BS) {
+  int i;
+  for (i = 0; i < BS; i++)
+    w[i] = v[i];
+}
+
+pkf packer[33] = {pack0, pack1, pack2, pack3, pack4, pack5, pack6, pack7, pack8,
+                  pack9, pack10, pack11, pack12, pack13, pack14, pack15, pack16,
+                  pack17, pack18, pack19, pack20, pack21, pack22, pack23, pack24,
+                  pack25, pack26, pack27, pack28, pack29, pack30, pack31, pack32};
+
+//
+// Packs any number of integers: the full chunks of 32 go through the kernel
+// of b, and the rest bit by bit.
 void pack(unsigned int* v, unsigned int b, unsigned int n, unsigned int* w) {
-  unsigned int i;
+  unsigned int i = 0;
   int bp, wp, s;
 
-  for (bp = 0, i = 0; i < n; i++, bp += b) {
+  if (b == 0)
+    return;
+  if ((b <= 32) && (n >= 32)) {
+    i = n & ~31u;
+    packer[b](v, w, i);
+  }
+
+  for (bp = i * b; i < n; i++, bp += b) {
     wp = bp >> 5;
     s = 32 - b - (bp & 31);
     if (s >= 0)
@@ -58,3 +145,37 @@ void pack(unsigned int* v, unsigned int b, unsigned int n, unsigned int* w) {
     }
   }
 }
+
+// Same as pack for 64-bit integers of b <= 64 bits, also packed MSB first
+// into 32-bit words. The words must be set to 0.
+void pack64(unsigned long long* v, unsigned int b, unsigned int n, unsigned int* w) {
+  unsigned int i, hb;
+  int bp, wp, s;
+
+  hb = (b > 32) ? b - 32 : 0;
+  for (bp = 0, i = 0; i < n; i++) {
+    // The high b - 32 bits, then the low 32 bits (or all of them if b <= 32).
+    if (hb > 0) {
+      wp = bp >> 5;
+      s = 32 - hb - (bp & 31);
+      if (s >= 0) {
+        w[wp] |= (unsigned int) (v[i] >> 32) << s;
+      } else {
+        w[wp] |= (unsigned int) (v[i] >> 32) >> -s;
+        w[wp + 1] |= (unsigned int) (v[i] >> 32) << (32 + s);
+      }
+      bp += hb;
+    }
+    if (b > 0) {
+      wp = bp >> 5;
+      s = 32 - (b - hb) - (bp & 31);
+      if (s >= 0) {
+        w[wp] |= (unsigned int) v[i] << s;
+      } else {
+        w[wp] |= (unsigned int) v[i] >> -s;
+        w[wp + 1] |= (unsigned int) v[i] << (32 + s);
+      }
+      bp += b - hb;
+    }
+  }
+}
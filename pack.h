@@ -45,6 +45,52 @@
 #ifndef PACK_H_
 #define PACK_H_
 
+// Packs 'n' integers of 'b' bits MSB first into 'w', whose words must be set
+// to 0. The values must fit in b bits.
 void pack(unsigned int* v, unsigned int b, unsigned int n, unsigned int* w);
 
+// Kernels for a whole block of 'BS' integers, a multiple of 32. They write
+// the b*BS/32 words of 'w', so there is no need to clear them first.
+void pack0(unsigned int* v, unsigned int* w, int BS);
+void pack1(unsigned int* v, unsigned int* w, int BS);
+void pack2(unsigned int* v, unsigned int* w, int BS);
+void pack3(unsigned int* v, unsigned int* w, int BS);
+void pack4(unsigned int* v, unsigned int* w, int BS);
+void pack5(unsigned int* v, unsigned int* w, int BS);
+void pack6(unsigned int* v, unsigned int* w, int BS);
+void pack7(unsigned int* v, unsigned int* w, int BS);
+void pack8(unsigned int* v, unsigned int* w, int BS);
+void pack9(unsigned int* v, unsigned int* w, int BS);
+void pack10(unsigned int* v, unsigned int* w, int BS);
+void pack11(unsigned int* v, unsigned int* w, int BS);
+void pack12(unsigned int* v, unsigned int* w, int BS);
+void pack13(unsigned int* v, unsigned int* w, int BS);
+void pack14(unsigned int* v, unsigned int* w, int BS);
+void pack15(unsigned int* v, unsigned int* w, int BS);
+void pack16(unsigned int* v, unsigned int* w, int BS);
+void pack17(unsigned int* v, unsigned int* w, int BS);
+void pack18(unsigned int* v, unsigned int* w, int BS);
+void pack19(unsigned int* v, unsigned int* w, int BS);
+void pack20(unsigned int* v, unsigned int* w, int BS);
+void pack21(unsigned int* v, unsigned int* w, int BS);
+void pack22(unsigned int* v, unsigned int* w, int BS);
+void pack23(unsigned int* v, unsigned int* w, int BS);
+void pack24(unsigned int* v, unsigned int* w, int BS);
+void pack25(unsigned int* v, unsigned int* w, int BS);
+void pack26(unsigned int* v, unsigned int* w, int BS);
+void pack27(unsigned int* v, unsigned int* w, int BS);
+void pack28(unsigned int* v, unsigned int* w, int BS);
+void pack29(unsigned int* v, unsigned int* w, int BS);
+void pack30(unsigned int* v, unsigned int* w, int BS);
+void pack31(unsigned int* v, unsigned int* w, int BS);
+void pack32(unsigned int* v, unsigned int* w, int BS);
+
+// Pointer to a pack kernel
+typedef void (*pkf)(unsigned int* v, unsigned int* w, int BS);
+
+// Kernel of each b.
+extern pkf packer[33];
+
+void pack64(unsigned long long* v, unsigned int b, unsigned int n, unsigned int* w);
+
 #endif /* PACK_H_ */
@@ -0,0 +1,77 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Vectorized pack functions.
+//
+// For 8 and 16 bits the values fall on byte boundaries, so packing is a
+// saturating narrowing (the values already fit, nothing saturates) followed
+// by a byte shuffle that puts the first value of each word at its most
+// significant end. The 32 bits kernel is a copy, which the compiler already
+// vectorizes, and the other widths straddle words, so they keep the scalar
+// kernels.
+//
+
+#include <stdlib.h>
+#include "pack.h"
+#include "pack_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+__attribute__((target("sse4.1")))
+static void pack8_sse(unsigned int* v, unsigned int* w, int BS) {
+  const __m128i rev = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  const __m128i* in = (const __m128i*) v;
+  __m128i a, b;
+  int i;
+
+  for (i = 0; i < BS; i += 16, in += 4, w += 4) {
+    a = _mm_packus_epi32(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+    b = _mm_packus_epi32(_mm_loadu_si128(in + 2), _mm_loadu_si128(in + 3));
+    _mm_storeu_si128((__m128i*) w, _mm_shuffle_epi8(_mm_packus_epi16(a, b), rev));
+  }
+}
+
+__attribute__((target("sse4.1")))
+static void pack16_sse(unsigned int* v, unsigned int* w, int BS) {
+  const __m128i* in = (const __m128i*) v;
+  __m128i a;
+  int i;
+
+  for (i = 0; i < BS; i += 8, in += 2, w += 4) {
+    a = _mm_packus_epi32(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+    // swap the two halves of each word: v[2i] << 16 | v[2i + 1]
+    a = _mm_or_si128(_mm_slli_epi32(a, 16), _mm_srli_epi32(a, 16));
+    _mm_storeu_si128((__m128i*) w, a);
+  }
+}
+
+__attribute__((constructor))
+void pack_simd_init(void) {
+  static int done = 0;
+
+  if (done)
+    return;
+  done = 1;
+
+  __builtin_cpu_init();
+  if ((getenv("CODEC_SCALAR") == NULL) && __builtin_cpu_supports("sse4.1")) {
+    packer[8] = pack8_sse;
+    packer[16] = pack16_sse;
+  }
+}
+
+#else
+
+void pack_simd_init(void) {
+}
+
+#endif
@@ -0,0 +1,24 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// SSE4.1 versions of the pack kernels for 8 and 16 bits, the widths of the
+// PForDelta exceptions. They write exactly the same format as pack.c.
+//
+// They are installed in the packer[] table at program startup when the CPU
+// supports them; the scalar kernels of pack.c remain as fallback.
+
+#ifndef PACK_SIMD_H_
+#define PACK_SIMD_H_
+
+// Installs the SIMD kernels in packer[]. It runs automatically before main(),
+// calling it again is harmless.
+void pack_simd_init(void);
+
+#endif /* PACK_SIMD_H_ */
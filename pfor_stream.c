@@ -0,0 +1,90 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+#include<stdlib.h>
+#include<string.h>
+#include "pfordelta.h"
+#include "coding_policy.h"
+#include "pfor_stream.h"
+
+int pfor_stream_init(struct pfor_stream *s, unsigned int *output, int block_size, int flags) {
+  memset(s, 0, sizeof(struct pfor_stream));
+  if (!PFOR_VALID_BLOCK_SIZE(block_size))
+    return -1;
+  s->block = malloc(block_size * sizeof(unsigned int));
+  if (s->block == NULL)
+    return -1;
+  s->output = output;
+  s->block_size = block_size;
+  s->flags = flags;
+  return 0;
+}
+
+int pfor_stream_set_sink(struct pfor_stream *s, pfor_sink sink, void *arg) {
+  // A block never takes more than its header plus 'block_size' words.
+  s->coded = malloc((s->block_size + 1) * sizeof(unsigned int));
+  if (s->coded == NULL)
+    return -1;
+  s->sink = sink;
+  s->sink_arg = arg;
+  return 0;
+}
+
+// Compresses the full block and sends it to the output.
+static void flush(struct pfor_stream *s) {
+  unsigned int *out = (s->sink != NULL) ? s->coded : s->output + s->words;
+  int n;
+
+  n = compress_pfordelta_block(s->block, out, s->block_size, s->flags, s->base);
+  s->base = s->block[s->block_size - 1];
+
+  if (s->sink != NULL)
+    s->sink(s->sink_arg, out, n);
+  s->words += n;
+  s->fill = 0;
+}
+
+void pfor_stream_add(struct pfor_stream *s, unsigned int value) {
+  s->block[s->fill++] = value;
+  s->num_elements++;
+  if (s->fill == s->block_size)
+    flush(s);
+}
+
+void pfor_stream_add_n(struct pfor_stream *s, unsigned int *values, int n) {
+  int k;
+
+  while (n > 0) {
+    k = (s->block_size - s->fill < n) ? s->block_size - s->fill : n;
+    memcpy(s->block + s->fill, values, k * sizeof(unsigned int));
+    s->fill += k;
+    s->num_elements += k;
+    values += k;
+    n -= k;
+    if (s->fill == s->block_size)
+      flush(s);
+  }
+}
+
+int pfor_stream_finish(struct pfor_stream *s) {
+  int i;
+
+  if (s->fill > 0) {
+    // Same padding as compress_pfordelta: 0s, or zero gaps in sorted mode.
+    for (i = s->fill; i < s->block_size; i++)
+      s->block[i] = (s->flags & PFOR_SORTED) ? s->block[s->fill - 1] : 0;
+    flush(s);
+  }
+
+  free(s->block);
+  free(s->coded);
+  s->block = NULL;
+  s->coded = NULL;
+  return s->words;
+}
@@ -0,0 +1,60 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Streaming PForDelta encoder. It takes the integers one at a time or in
+// batches and compresses each block as soon as it is full, so it only keeps
+// one block of integers in memory. The result is the same stream
+// compress_pfordelta (or compress_pfordelta_sorted) gives for all the integers.
+//
+// Usage:
+//   struct pfor_stream s;
+//   pfor_stream_init(&s, output, 128, 0);
+//   pfor_stream_add(&s, x); ...
+//   words = pfor_stream_finish(&s);
+//
+// Instead of an output array, a sink function can receive each compressed
+// block (see pfor_stream_set_sink), e.g. to write it to a file.
+
+#ifndef PFOR_STREAM_H_
+#define PFOR_STREAM_H_
+
+typedef void (*pfor_sink)(void *arg, unsigned int *words, int num_words);
+
+struct pfor_stream {
+  unsigned int *block;   // integers of the current block
+  unsigned int *coded;   // compressed block, when there is a sink
+  unsigned int *output;  // where the next block is written, when there is no sink
+  pfor_sink sink;
+  void *sink_arg;
+  int block_size;
+  int flags;             // format flags, see coding_policy.h
+  int fill;              // integers in 'block'
+  unsigned int base;     // last integer of the previous block, for PFOR_SORTED
+  int num_elements;      // integers added
+  int words;             // words written
+};
+
+// Starts a stream that writes to 'output'. 'flags' can be PFOR_SORTED, PFOR_NEWPFD, PFOR_OPTIMAL and PFOR_HYBRID.
+// Returns 0, or -1 if the block size is not valid (see PFOR_MAX_BLOCK_SIZE) or the block buffer cannot be allocated.
+int pfor_stream_init(struct pfor_stream *s, unsigned int *output, int block_size, int flags);
+
+// Sends every compressed block to 'sink' instead of writing to the output array.
+// It must be called before adding integers. Returns 0, or -1 on allocation failure.
+int pfor_stream_set_sink(struct pfor_stream *s, pfor_sink sink, void *arg);
+
+// Add one integer, or 'n' integers.
+void pfor_stream_add(struct pfor_stream *s, unsigned int value);
+void pfor_stream_add_n(struct pfor_stream *s, unsigned int *values, int n);
+
+// Compresses the last, partial, block and frees the buffers.
+// Returns the total number of 32-bits words of the stream.
+int pfor_stream_finish(struct pfor_stream *s);
+
+#endif /* PFOR_STREAM_H_ */
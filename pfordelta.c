@@ -44,7 +44,8 @@
 // This is an implementation of PForDelta algorithm for sorted integer arrays.
 // The PForDelta coding method is fast but compression efficiency is not as good as Rice
 // coding. It is a blockwise coding, so you need to first set the block size to
-// either 32, 64, 128, or 256. The default block size is 128. If the input
+// a multiple of 32, up to PFOR_MAX_BLOCK_SIZE (large blocks, 512 to 4096, save
+// headers and calls on long lists). The default block size is 128. If the input
 // buffer to the Compression() function is greater in size than the block size,
 // any integers past the block size will be discarded.
 // The meta data is stored as an uncompressed integer written at the beginning
@@ -58,6 +59,9 @@
 // 2. Optimizacion from:
 //     http://www2008.org/papers/pdf/p387-zhangA.pdf
 //
+// 3. NewPFD format (pfor_compress_newpfd) from:
+//     http://dx.doi.org/10.1145/1526709.1526764
+//
 // Alternative implementations:
 //   * C++ http://code.google.com/p/poly-ir-toolkit/source/browse/trunk/src/compression_toolkit/pfor_coding.cc
 //   * Java https://github.com/hyan/kamikaze/blob/master/src/main/java/com/kamikaze/pfordelta/PForDelta.java
@@ -68,52 +72,469 @@
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 
 #include "pfordelta.h"
+#include "codec_stats.h"
+#include "delta.h"
 #include "pack.h" //for pack function
 #include "unpack.h"
+#include "s16.h"
+
+// The values of b of the original PForDelta, the ones the 4 bits field of the
+// classic header can hold. Every b from 0 to 32 has unpack and pack kernels.
+const int pfor_cnum[17] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,16,20,32};
+
+const float FRAC = 0.1; // percent of exceptions in block_size
+
+// Cost in bits of each exception for pfor_select_opt, added to the bits it
+// takes in the block. Every exception is a dependent step of the patch loop,
+// so a cost above 0 trades some size for decoding speed on skewed data; with
+// 0 the smallest block is chosen.
+#ifndef PFOR_EXCEPTION_COST
+#define PFOR_EXCEPTION_COST 0
+#endif
+
+// Index in pfor_cnum of each b, -1 if it is not one of them.
+const signed char pfor_index[33] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,-1,-1,14,
+                                           -1,-1,-1,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,16};
+
+// Header of a classic block: 'start' (the first exception, block_size if
+// there is none) takes bits 0..9 and 16..23, which hold any position of a
+// block of PFOR_MAX_BLOCK_SIZE integers, and t bits 10..11. When b is in pfor_cnum its index,
+// minus one, goes in bits 12..15, as it always did; any other b sets
+// PFOR_WIDE and goes in bits 24..29. So blocks of up to 1023 integers with
+// the original widths leave bits 16..31 to 0.
+#define PFOR_WIDE (1u << 30)
+#define PFOR_START(flag) (((flag) & 1023) | (((flag) >> 6) & 0x3FC00))
+
+static inline int pfor_header(int b, int t, int start) {
+  int flag = ((start >> 10) << 16) + (t << 10) + (start & 1023);
+
+  if (pfor_index[b] > 0)
+    return flag + ((pfor_index[b] - 1) << 12);
+  return flag | PFOR_WIDE | (b << 24);
+}
 
-extern pf unpack[17]; //array to the unpack functions defined in unpack.h
+// b of a classic block.
+static inline int pfor_width(int flag) {
+  if (flag & PFOR_WIDE)
+    return (flag >> 24) & 63;
+  return pfor_cnum[((flag >> 12) & 15) + 1];
+}
 
-// from pfor_coding.h
-int b;  // b size
-int unpack_count; // 
-int t; // code for exception size in bits
-int start; // first exception
+// Blocks of the hybrid mode that are not PForDelta (see pfor_compress_hybrid)
+// have a classic header with PFOR_WIDE and a b above 32, which tells their
+// kind, and 24 bits of data:
+//   PFOR_CONSTANT every integer is the same one, stored in the data bits, or
+//                 in the next word if it is PFOR_KIND_DATA or more,
+//   PFOR_S16      Simple16 words follow, in the escaped format of
+//                 s16_compress_esc, the data bits hold their number.
+#define PFOR_CONSTANT 33
+#define PFOR_S16 34
+#define PFOR_KIND_DATA 0xFFFFFF
+#define PFOR_KIND_HEADER(kind, data) ((int) (PFOR_WIDE | ((kind) << 24) | (data)))
+
+// Header of a NewPFD block: the flag, b, the bits of the exceptions high part
+// and the number of exceptions. Classic blocks leave bit 31 to 0.
+#define NEWPFD_FLAG (1u << 31)
+#define NEWPFD_HEADER(b, hb, n) (NEWPFD_FLAG | ((unsigned) (b) << 25) | ((unsigned) (hb) << 19) | (unsigned) (n))
+#define NEWPFD_B(flag) (((unsigned) (flag) >> 25) & 63)
+#define NEWPFD_HB(flag) (((unsigned) (flag) >> 19) & 63)
+#define NEWPFD_N(flag) ((unsigned) (flag) & 0x7FFFF)
+
+// Bits needed to store a position in a block.
+static inline int position_bits(int block_size) {
+  return (block_size > 1) ? 32 - __builtin_clz(block_size - 1) : 0;
+}
 
-int block_size = 128; // can be 32, 64, 128, 256
-                      // depende del tamaño del size <64, <128, <256
+// Words needed by n values of 'bits' bits.
+static inline int packed_words(int bits, int n) {
+  return (bits * n + 31) >> 5;
+}
 
-//All possible values of b in the PForDelta algorithm
-int pfor_cnum[17] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,16,20,32};
+void *pfor_scratch(void *stack, size_t stack_bytes, size_t bytes) {
+  return (bytes <= stack_bytes) ? stack : malloc(bytes);
+}
+
+void pfor_scratch_free(void *scratch, void *stack) {
+  if (scratch != stack)
+    free(scratch);
+}
 
-float FRAC = 0.1; // percent of exceptions in block_size
+static int newpfd_compress(unsigned int *input, unsigned int *output, int size, int opt);
+static unsigned* pfor_decode_newpfd(unsigned int* _p, unsigned int* _w, int flag, int block_size);
+static unsigned* pfor_decode_kind(unsigned int* _p, unsigned int* _w, int flag, int block_size);
+
+#ifdef CODEC_STATS
+// Counts a block compressed with b bits and the 'n' exceptions 'ex' of type t.
+static void count_block(int b, int t, int n, unsigned int* ex) {
+  int i;
+
+  CODEC_STATS_ADD(pfor_blocks, 1);
+  CODEC_STATS_ADD(pfor_b[b], 1);
+  CODEC_STATS_ADD(pfor_exceptions, n);
+  if (n > 0) {
+    CODEC_STATS_ADD(pfor_exception_blocks[t], 1);
+    CODEC_STATS_ADD(pfor_exception_count[t], n);
+  }
+  for (i = 0; i < n; i++)
+    CODEC_STATS_ADD(pfor_forced, ex[i] < (1u << b));
+}
+
+// Counts the 'n' Simple16 words 'w' (escaped format) of a block.
+static void count_s16_words(unsigned int* w, int n) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    CODEC_STATS_ADD(s16_words, 1);
+    CODEC_STATS_ADD(s16_selector[w[i] >> 28], 1);
+    if (w[i] == S16_ESCAPE) {
+      CODEC_STATS_ADD(s16_words, 1);
+      i++;
+    }
+  }
+}
+#else
+#define count_block(b, t, n, ex) ((void) 0)
+#define count_s16_words(w, n) ((void) 0)
+#endif
+
+// Fills hist[i] with the number of integers needing more than i bits.
+static void width_histogram(unsigned int* p, int size, int* hist) {
+  int i, n, c;
+
+  for (i = 0; i <= 32; i++)
+    hist[i] = 0;
+  for (i = 0; i < size; i++)
+    hist[(p[i] == 0) ? 0 : 32 - __builtin_clz(p[i])]++;
+  for (n = 0, i = 32; i >= 0; i--) {
+    c = hist[i];
+    hist[i] = n;
+    n += c;
+  }
+}
+
+// Number of exceptions forced with b bits, as an exception is forced every
+// 2^b positions after the last one.
+static int forced_exceptions(unsigned int* p, int size, int b) {
+  int i, l, n = 0;
+
+  if ((b >= 31) || ((1 << b) >= size))
+    return 0;
+  for (l = -1, i = 0; i < size; i++) {
+    if (p[i] >> b) {
+      if (l >= 0)
+        n += (i - l - 1) >> b;
+      l = i;
+    }
+  }
+  return n + ((size - 1 - l) >> b);
+}
 
 //
 // Compress an integer array using PForDelta
 // Parameters:
 //    input pointer to the array of integers to compress
 //    output pointer to the array of compressed integers
-//    size (not used)
+//    size block size (a multiple of 32, up to PFOR_MAX_BLOCK_SIZE)
 // Returns:
 //    the number of 32-bits words used to compress the input
 int pfor_compress(unsigned int *input, unsigned int *output, int size) {
-  int flag = -1; // ?
+  unsigned int* w = output + 1;
+
+  *output = pfor_encode(&w, input, pfor_select(input, size), size);
+  return w - output;
+}
+
+//
+// Compress a block of a sorted integer array using PForDelta, storing the
+// differences between consecutive integers.
+// Parameters:
+//    input pointer to the array of integers to compress, it is not modified
+//    output pointer to the array of compressed integers
+//    size block size
+//    base integer before the block (the last one of the previous block, or 0)
+// Returns:
+//    the number of 32-bits words used to compress the input
+int pfor_compress_sorted(unsigned int *input, unsigned int *output, int size, unsigned int base) {
+  unsigned int stack[PFOR_STACK_BLOCK];
+  unsigned int *gaps = pfor_scratch(stack, sizeof(stack), size * sizeof(unsigned int));
+  unsigned int* w = output + 1;
+  int n;
+
+  if (gaps == NULL) {
+    // The gaps are stored as they are (b = 32), in the block itself.
+    delta_encode(input, w, size, base);
+    *output = pfor_encode(&w, w, 32, size);
+    return w - output;
+  }
+  delta_encode(input, gaps, size, base);
+  n = pfor_compress(gaps, output, size);
+  pfor_scratch_free(gaps, stack);
+  return n;
+}
+
+//
+// Compress an integer array using PForDelta with the b that gives the
+// smallest block, see pfor_select_opt. It is slower than pfor_compress,
+// the decoding speed is the same.
+// Parameters:
+//    input pointer to the array of integers to compress
+//    output pointer to the array of compressed integers
+//    size block size
+// Returns:
+//    the number of 32-bits words used to compress the input
+int pfor_compress_opt(unsigned int *input, unsigned int *output, int size) {
+  unsigned int* w = output + 1;
+
+  *output = pfor_encode(&w, input, pfor_select_opt(input, size), size);
+  return w - output;
+}
+
+//
+// Compress an integer array using the NewPFD format. The exceptions keep their
+// low b bits in the packed array, and their positions and high bits are
+// stored in two packed arrays after it, so there are no forced exceptions
+// and the decoder patches them with independent stores. b is the smallest
+// width, 0 included, leaving at most FRAC * size exceptions.
+// The block is decoded by pfor_decompress, as it tells both formats apart.
+// Parameters:
+//    input pointer to the array of integers to compress
+//    output pointer to the array of compressed integers
+//    size block size
+// Returns:
+//    the number of 32-bits words used to compress the input
+int pfor_compress_newpfd(unsigned int *input, unsigned int *output, int size) {
+  return newpfd_compress(input, output, size, 0);
+}
+
+//
+// Same as pfor_compress_newpfd, with the b that gives the smallest block.
+// The exceptions are patched with independent stores, so their number is
+// not bounded, nor do they get the cost of pfor_select_opt.
+int pfor_compress_newpfd_opt(unsigned int *input, unsigned int *output, int size) {
+  return newpfd_compress(input, output, size, 1);
+}
+
+static int newpfd_compress(unsigned int *input, unsigned int *output, int size, int opt) {
+  unsigned int stack[3 * PFOR_STACK_BLOCK];
+  unsigned int* low = NULL;  // integers masked to b bits
+  unsigned int* pos = NULL;  // positions of the exceptions
+  unsigned int* high = NULL; // exceptions shifted right by b
+  int hist[33];
+  unsigned int* w = output + 1;
+  unsigned int m = 0;
+  int i, b, hb, n, pb, s, words, best_words;
+
+  width_histogram(input, size, hist);
+  pb = position_bits(size);
+  // The exceptions need the bits of the largest integer beyond b.
+  for (hb = 32; (hb > 0) && (hist[hb - 1] == 0); hb--)
+    ;
+  if (opt) {
+    for (b = 32, best_words = size, i = 0; i < 32; i++) {
+      n = hist[i];
+      words = ((i * size) >> 5) + packed_words(pb, n) + packed_words(hb - i, n);
+      if (words < best_words) {
+        b = i;
+        best_words = words;
+      }
+    }
+  } else {
+    for (b = 0; (b < 32) && ((double) (hist[b]) > FRAC * (double) (size)); b++)
+      ;
+    // A wide b with its exceptions can take more than the integers as they are.
+    if ((b < 32) && (((b * size) >> 5) + packed_words(pb, hist[b]) + packed_words(hb - b, hist[b]) > size))
+      b = 32;
+  }
+
+  // Without room to split the integers, they are stored as they are.
+  if ((b < 32) && ((low = pfor_scratch(stack, sizeof(stack), 3 * size * sizeof(unsigned int))) == NULL))
+    b = 32;
+
+  n = 0;
+  if (b < 32) {
+    pos = low + size;
+    high = pos + size;
+    for (i = 0; i < size; i++) {
+      if (input[i] >> b) {
+        pos[n] = i;
+        high[n] = input[i] >> b;
+        m |= high[n++];
+        low[i] = input[i] & ((1u << b) - 1);
+      } else {
+        low[i] = input[i];
+      }
+    }
+  }
+  hb = (m == 0) ? 0 : 32 - __builtin_clz(m);
+
+  packer[b]((b < 32) ? low : input, w, size);
+  w += (b * size) >> 5;
+
+  s = packed_words(pb, n) + packed_words(hb, n);
+  for (i = 0; i < s; i++)
+    w[i] = 0;
+  if (n > 0) {
+    pack(pos, pb, n, w);
+    w += packed_words(pb, n);
+    pack(high, hb, n, w);
+    w += packed_words(hb, n);
+  }
+  if (b < 32)
+    pfor_scratch_free(low, stack);
+
+  CODEC_STATS_ADD(pfor_blocks, 1);
+  CODEC_STATS_ADD(pfor_b[b], 1);
+  CODEC_STATS_ADD(pfor_exceptions, n);
+  *output = NEWPFD_HEADER(b, hb, n);
+  return w - output;
+}
+
+//
+// Hybrid mode: replaces the PForDelta block of 'words' words compressed from
+// 'input' in 'output' by a block of another kind when it is smaller, so each
+// block of a stream gets the codec that suits it:
+//   - a constant block, if all the integers are the same one,
+//   - a classic block with the b of the largest integer, that is, plain bit
+//     packing with no exception to patch, if it is not larger,
+//   - a Simple16 block, if it is smaller.
+// Ties go to the kind that decodes faster. pfor_decompress, pfor_decode and
+// pfor_skip read every kind.
+// With -DCODEC_STATS, the caller marks the counters (CODEC_STATS_MARK) before
+// compressing the PForDelta block, so its counts are dropped if another kind
+// replaces it; only the kept block is counted.
+// Parameters:
+//    input pointer to the block
+//    output pointer to the PForDelta block, replaced
+//    size block size
+//    words size of the PForDelta block
+// Returns:
+//    the number of 32-bits words of the block
+int pfor_compress_hybrid(unsigned int *input, unsigned int *output, int size, int words) {
+  unsigned int stack[2 * PFOR_STACK_BLOCK];
+  unsigned int* tmp; // Simple16 takes 2 words per integer at most
   unsigned int* w;
-  int k; // ?
-  for (k = 0; flag < 0; k++) {
+  unsigned int m;
+  int i, b, n;
+
+  for (i = 1; (i < size) && (input[i] == input[0]); i++)
+    ;
+  if (i == size) {
+    CODEC_STATS_DROP();
+    CODEC_STATS_ADD(pfor_constant, 1);
+    if (input[0] < PFOR_KIND_DATA) {
+      output[0] = PFOR_KIND_HEADER(PFOR_CONSTANT, input[0]);
+      return 1;
+    }
+    output[0] = PFOR_KIND_HEADER(PFOR_CONSTANT, PFOR_KIND_DATA);
+    output[1] = input[0];
+    return 2;
+  }
+
+  for (m = 0, i = 0; i < size; i++)
+    m |= input[i];
+  b = 32 - __builtin_clz(m); // m > 0, the integers are not all the same
+  if (1 + ((b * size) >> 5) <= words) {
+    CODEC_STATS_DROP();
     w = output + 1;
-    flag = pfor_encode(&w, input, k);
+    *output = pfor_encode(&w, input, b, size);
+    words = w - output;
   }
 
-  *output = flag;
-  return w - output;
+  // Simple16 is only tried when there is room for its words.
+  tmp = pfor_scratch(stack, sizeof(stack), 2 * size * sizeof(unsigned int));
+  if (tmp == NULL)
+    return words;
+  CODEC_STATS_PAUSE(1);
+  n = s16_compress_esc(input, tmp, size);
+  CODEC_STATS_PAUSE(0);
+  if (1 + n < words) {
+    CODEC_STATS_DROP();
+    CODEC_STATS_ADD(pfor_s16, 1);
+    count_s16_words(tmp, n);
+    output[0] = PFOR_KIND_HEADER(PFOR_S16, n);
+    memcpy(output + 1, tmp, n * sizeof(unsigned int));
+    words = 1 + n;
+  }
+  pfor_scratch_free(tmp, stack);
+  return words;
+}
+
+//
+// Choose the b used to compress a block, that is, the smallest b > 0 whose
+// exceptions (the integers that do not fit in b bits, plus the ones
+// forced to keep the distance between exceptions below 2^b) are at most
+// FRAC * size. It gives the same b as trying pfor_encode with each b in
+// turn, but the block is scanned only once to build a histogram of bit
+// widths, and the positions are scanned again only to count the forced
+// exceptions of small b.
+// Parameters:
+//    p pointer to the block
+//    size block size
+// Returns:
+//    b
+int pfor_select(unsigned int* p, int size) {
+  int hist[33]; // number of integers needing more than i bits
+  int b, n;
+
+  width_histogram(p, size, hist);
+  for (b = 1; b < 32; b++) {
+    n = hist[b];
+    if ((double) (n) > FRAC * (double) (size))
+      continue;
+    if (n > 0)
+      n += forced_exceptions(p, size, b);
+    if ((double) (n) <= FRAC * (double) (size))
+      break;
+  }
+
+  CODEC_STATS_ADD(pfor_rejected[b - 1], 1);
+  return b;
+}
+
+//
+// Choose the b that gives the smallest block (OptPFD), computing the exact
+// size pfor_encode would write with each b: the packed integers plus the
+// exceptions, forced ones included. Each exception also counts
+// PFOR_EXCEPTION_COST bits, 0 unless it is defined when building.
+// Parameters:
+//    p pointer to the block
+//    size block size
+// Returns:
+//    b
+int pfor_select_opt(unsigned int* p, int size) {
+  int hist[33];
+  int best, b, n, bb;
+  long cost, best_cost;
+
+  width_histogram(p, size, hist);
+  // Exception width of pfor_encode, it depends on the largest integer only.
+  bb = (hist[8] == 0) ? 8 : ((hist[16] == 0) ? 16 : 32);
+
+  best = 32;
+  best_cost = 32L * size;
+  for (b = 1; b < 32; b++) {
+    n = hist[b];
+    if (n > 0)
+      n += forced_exceptions(p, size, b);
+    cost = 32L * (((b * size) >> 5) + ((bb * n + 31) >> 5)) + (long) PFOR_EXCEPTION_COST * n;
+    if (cost < best_cost) {
+      best = b;
+      best_cost = cost;
+    }
+  }
+  return best;
 }
 
 // w: output
 // p: input
-// j: ?
-int pfor_encode(unsigned int** w, unsigned int* p, int num) {
+// b: bits of the packed integers, 1 to 32, from pfor_select or pfor_select_opt
+// block_size: number of integers in the block
+// Returns the header of the block. Any b is accepted, whatever the number of exceptions;
+// the block is stored with b = 32 when it would be larger otherwise.
+int pfor_encode(unsigned int** w, unsigned int* p, int b, int block_size) {
   // bb bit size of exceptions
   // t code for bit size exceptions
   // i index to retrieve all numbers in block size
@@ -122,11 +543,11 @@ int pfor_encode(unsigned int** w, unsigned int* p, int num) {
   // s
   int i, l, n, bb, t, s;
   unsigned int m; // largest number in sequence
-  int b = pfor_cnum[num + 1]; // the b value in pfordelta :)
   int start;  // first exception ;)
 
-  unsigned int out[block_size]; // array for non-exceptions
-  unsigned int ex[block_size]; // array for exceptions
+  unsigned int stack[2 * PFOR_STACK_BLOCK];
+  unsigned int* out; // array for non-exceptions
+  unsigned int* ex; // array for exceptions
   
   //printf("unsing b = %d bits\n",b);
   
@@ -136,9 +557,15 @@ int pfor_encode(unsigned int** w, unsigned int* p, int num) {
       (*w)[i] = p[i];
     }
     *w += block_size;
-    return ((num << 12) + (2 << 10) + block_size);
+    count_block(b, 2, 0, NULL);
+    return pfor_header(b, 2, block_size);
   }
 
+  // Without room for the exceptions, the block is stored with b = 32.
+  if ((out = pfor_scratch(stack, sizeof(stack), 2 * block_size * sizeof(unsigned int))) == NULL)
+    return pfor_encode(w, p, 32, block_size);
+  ex = out + block_size;
+
   // Find the largest number we're encoding.
   for (m = 0, i = 0; i < block_size; i++) {
     if (p[i] > m)
@@ -161,8 +588,8 @@ int pfor_encode(unsigned int** w, unsigned int* p, int num) {
 
   // Selecting exceptions and non-exceptions
   for (start = 0, n = 0, l = -1, i = 0; i < block_size; i++) {
-    if ((p[i] >= (unsigned) (1 << b)) // p[i] fits in b bits?
-	|| ((l >= 0) && (i - l == (1 << b))) // the distance between this exception 
+    if ((p[i] >= (1u << b)) // p[i] fits in b bits?
+	|| ((l >= 0) && ((unsigned) (i - l) == (1u << b))) // the distance between this exception 
 	) {                                  // and the last exception fits in b bits
       if (l < 0)
         start = i;
@@ -177,33 +604,35 @@ int pfor_encode(unsigned int** w, unsigned int* p, int num) {
   }
 
   if (l >= 0)
-    out[l] = (1 << b) - 1;
+    out[l] = (1u << b) - 1;
   else
     start = block_size;
 
-  if ( (double) (n) <= FRAC * (double) (block_size)) {
-    // non-exceptions in b bits
-
-    // s*bytes is the size of the b-bits words non-exception
-    s = ((b * block_size) >> 5); 
-    for (i = 0; i < s; i++) {
-      (*w)[i] = 0;
-    }
-    pack(out, b, block_size, *w);
-    *w += s;
-
-    // exceptions in bb bits
-    // size*4bytes of the excepcion array
-    s = ((bb * n) >> 5) + ((((bb * n) & 31) > 0) ? 1 : 0);
-    for (i = 0; i < s; i++) {
-      (*w)[i] = 0;
-    }
-    pack(ex, bb, n, *w);
-    *w += s;
-    return ((num << 12) + (t << 10) + start); // this is the header!!!
+  // A wide b with many exceptions can take more than the integers as they
+  // are, so no block is larger than block_size words plus the header.
+  if (((b * block_size) >> 5) + ((bb * n + 31) >> 5) > block_size) {
+    pfor_scratch_free(out, stack);
+    return pfor_encode(w, p, 32, block_size);
   }
 
-  return -1;
+  // non-exceptions in b bits
+
+  // s*bytes is the size of the b-bits words non-exception
+  s = ((b * block_size) >> 5); 
+  packer[b](out, *w, block_size);
+  *w += s;
+
+  // exceptions in bb bits
+  // size*4bytes of the excepcion array
+  s = ((bb * n) >> 5) + ((((bb * n) & 31) > 0) ? 1 : 0);
+  for (i = 0; i < s; i++) {
+    (*w)[i] = 0;
+  }
+  pack(ex, bb, n, *w);
+  *w += s;
+  count_block(b, t, n, ex);
+  pfor_scratch_free(out, stack);
+  return pfor_header(b, t, start); // this is the header!!!
 }
 
 //
@@ -211,45 +640,111 @@ int pfor_encode(unsigned int** w, unsigned int* p, int num) {
 // Parameters:
 //    input pointer to the array of compressed integers to decompress
 //    output pointer to the array of integers
-//    size (not used)
+//    size block size used to compress the input
 // Returns:
 //    the number of 32-bits consumed in input
 //
 int pfor_decompress(unsigned int* input, unsigned int* output, int size) {
   unsigned int* tmp = input;
   int flag = *tmp;
-  
-  b = pfor_cnum[((flag >> 12) & 15) + 1];
-  unpack_count = ((flag >> 12) & 15) + 1;
-  t = (flag >> 10) & 3;
-  start = flag & 1023;
 
   tmp++;
-  tmp = pfor_decode(output, tmp, flag);
+  tmp = pfor_decode(output, tmp, flag, size);
   return tmp - input;
 }
 
-unsigned* pfor_decode(unsigned int* _p, unsigned int* _w, int flag) {
-  int i, s;
-  unsigned int x;
-  
+//
+// Decompress a block compressed with pfor_compress_sorted. The gaps are
+// unpacked and patched into 'output', then added up in place by a second
+// pass, which finds the block still in cache. The patch needs the unpacked
+// slots to follow the exception chain, so the sum cannot go in the unpack
+// kernels; even on blocks without exceptions, a kernel adding up its lanes
+// before the store was no faster than this pass.
+// Parameters:
+//    input pointer to the array of compressed integers to decompress
+//    output pointer to the array of integers
+//    size block size used to compress the input
+//    base integer before the block, the same given to pfor_compress_sorted
+// Returns:
+//    the number of 32-bits consumed in input
+//
+int pfor_decompress_sorted(unsigned int* input, unsigned int* output, int size, unsigned int base) {
+  unsigned int* tmp = pfor_decode(output, input + 1, *input, size);
+
+  delta_decode(output, size, base);
+  return tmp - input;
+}
+
+//
+// Skip a block compressed using PForDelta without decompressing it
+// Parameters:
+//    input pointer to the compressed block
+//    size block size used to compress the input
+// Returns:
+//    the number of 32-bits words of the block
+//
+// Only the b-bit slots of the exceptions are read, to follow their chain and
+// count how many exception values are stored after the packed integers.
+int pfor_skip(unsigned int* input, int size) {
+  int flag = *input;
+  int b = pfor_width(flag);
+  int t = (flag >> 10) & 3;
+  unsigned int* _w = input + 1;
+  int n, bp, sh;
+  unsigned int s, x;
+
+  if (flag & NEWPFD_FLAG)
+    return 1 + ((NEWPFD_B(flag) * size) >> 5) + packed_words(position_bits(size), NEWPFD_N(flag))
+           + packed_words(NEWPFD_HB(flag), NEWPFD_N(flag));
+  if (b == PFOR_S16)
+    return 1 + (flag & PFOR_KIND_DATA);
+  if (b == PFOR_CONSTANT)
+    return 1 + ((flag & PFOR_KIND_DATA) == PFOR_KIND_DATA);
+
+  for (s = PFOR_START(flag), n = 0; s < (unsigned) size; n++) {
+    bp = s * b;
+    sh = 32 - b - (bp & 31);
+    if (sh >= 0)
+      x = _w[bp >> 5] >> sh;
+    else
+      x = (_w[bp >> 5] << -sh) | (_w[(bp >> 5) + 1] >> (32 + sh));
+    s += (x & ((1u << b) - 1)) + 1;
+  }
+
+  n = (t == 0) ? ((n + 3) >> 2) : ((t == 1) ? ((n + 1) >> 1) : n);
+  return 1 + ((b * size) >> 5) + n;
+}
+
+unsigned* pfor_decode(unsigned int* _p, unsigned int* _w, int flag, int block_size) {
+  int i;
+  unsigned int s, x; // s can go up to 2^b past the block
+  int b = pfor_width(flag);         // b size
+  int t = (flag >> 10) & 3;         // code for exception size in bits
+  int start = PFOR_START(flag);     // first exception
+
+  if (flag & NEWPFD_FLAG)
+    return pfor_decode_newpfd(_p, _w, flag, block_size);
+  if (b > 32)
+    return pfor_decode_kind(_p, _w, flag, block_size);
+
   // Esta es una llamada a un arreglo de funciones de unpack.
   // La idea es ahorrarse un if o switch-case por cada una de
-  // las funciones que dependenden de unpack_count.
-  // La definición de arreglo unpack[] está en "coding.h"
+  // las funciones que dependenden de b.
+  // La definición de arreglo unpack[] está en "unpack.h"
   // El código equivalente con switch-case sería:
-  //   switch(unpack_count) { */
+  //   switch(b) { */
   //     case 0: unpack0(_p, _w, block_size); break;
   //     case 1: unpack1(_p, _w, block_size); break;
   //     ...
   //     case n: unpack...; break; }
-  (unpack[unpack_count])(_p, _w, block_size);
+  // unpack_table da las versiones especializadas para block_size, si las hay.
+  (unpack_table(block_size)[b])(_p, _w, block_size);
 
   _w += ((b * block_size) >> 5);
 
   switch (t) {
     case 0:
-      for (s = start, i = 0; s < block_size; i++) {
+      for (s = start, i = 0; s < (unsigned) block_size; i++) {
         x = _p[s] + 1;
         _p[s] = (_w[i >> 2] >> (24 - ((i & 3) << 3))) & 255;
         s += x;
@@ -261,7 +756,7 @@ unsigned* pfor_decode(unsigned int* _p, unsigned int* _w, int flag) {
       break;
 
     case 1:
-      for (s = start, i = 0; s < block_size; i++) {
+      for (s = start, i = 0; s < (unsigned) block_size; i++) {
         x = _p[s] + 1;
         _p[s] = (_w[i >> 1] >> (16 - ((i & 1) << 4))) & 65535;
         s += x;
@@ -272,7 +767,7 @@ unsigned* pfor_decode(unsigned int* _p, unsigned int* _w, int flag) {
       break;
 
     case 2:
-      for (s = start, i = 0; s < block_size; i++) {
+      for (s = start, i = 0; s < (unsigned) block_size; i++) {
         x = _p[s] + 1;
         _p[s] = _w[i];
         s += x;
@@ -285,3 +780,51 @@ unsigned* pfor_decode(unsigned int* _p, unsigned int* _w, int flag) {
 
 
 
+
+// Value i of an array of 'bits' bits values packed MSB first.
+static inline unsigned int packed_get(unsigned int* w, int bits, int i) {
+  int bp = i * bits;
+  int sh = 32 - bits - (bp & 31);
+
+  if (bits == 0)
+    return 0;
+  if (sh >= 0)
+    return (w[bp >> 5] >> sh) & (0xFFFFFFFFu >> (32 - bits));
+  return ((w[bp >> 5] << -sh) | (w[(bp >> 5) + 1] >> (32 + sh))) & (0xFFFFFFFFu >> (32 - bits));
+}
+
+// Decode a block written by pfor_compress_newpfd. Every exception is patched
+// from its own position and high bits, there is no chain to follow.
+static unsigned* pfor_decode_newpfd(unsigned int* _p, unsigned int* _w, int flag, int block_size) {
+  int b = NEWPFD_B(flag);
+  int hb = NEWPFD_HB(flag);
+  int n = NEWPFD_N(flag);
+  int pb = position_bits(block_size);
+  unsigned int* wp;
+  unsigned int* wh;
+  int i;
+
+  (unpack_table(block_size)[b])(_p, _w, block_size);
+  _w += (b * block_size) >> 5;
+
+  wp = _w;
+  wh = wp + packed_words(pb, n);
+  for (i = 0; i < n; i++)
+    _p[packed_get(wp, pb, i)] |= packed_get(wh, hb, i) << b;
+  return wh + packed_words(hb, n);
+}
+
+// Decode a constant or Simple16 block of the hybrid mode.
+static unsigned* pfor_decode_kind(unsigned int* _p, unsigned int* _w, int flag, int block_size) {
+  unsigned int v = flag & PFOR_KIND_DATA;
+  int i;
+
+  if (pfor_width(flag) == PFOR_S16)
+    return _w + s16_decompress_esc(_w, _p, block_size);
+
+  if (v == PFOR_KIND_DATA)
+    v = *_w++;
+  for (i = 0; i < block_size; i++)
+    _p[i] = v;
+  return _w;
+}
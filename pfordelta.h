@@ -43,9 +43,36 @@
 #ifndef PFORDELTA_H_
 #define PFORDELTA_H_
 
+#include<stddef.h>
+
+// Block sizes are multiples of 32 up to PFOR_MAX_BLOCK_SIZE; the functions
+// compressing whole arrays refuse any other one.
+#define PFOR_MAX_BLOCK_SIZE 65536
+#define PFOR_VALID_BLOCK_SIZE(size) (((size) > 0) && ((size) <= PFOR_MAX_BLOCK_SIZE) && (((size) & 31) == 0))
+
+// The encoders keep their scratch arrays on the stack for blocks of up to
+// PFOR_STACK_BLOCK integers and take them from the heap for larger ones, so
+// the threads of compress_pfordelta_mt need no large stacks. pfor_scratch
+// returns 'stack' when 'bytes' fit in it, NULL if the allocation fails.
+#define PFOR_STACK_BLOCK 1024
+void *pfor_scratch(void *stack, size_t stack_bytes, size_t bytes);
+void pfor_scratch_free(void *scratch, void *stack);
+
+extern const int pfor_cnum[17];      // the widths of the original PForDelta
+extern const signed char pfor_index[33]; // index of each width in pfor_cnum, or -1
+
 int pfor_compress(unsigned int *input, unsigned int *output, int size);
-int  pfor_encode(unsigned int** w, unsigned int* p, int num);
+int pfor_compress_sorted(unsigned int *input, unsigned int *output, int size, unsigned int base);
+int pfor_compress_opt(unsigned int *input, unsigned int *output, int size);
+int pfor_compress_newpfd(unsigned int *input, unsigned int *output, int size);
+int pfor_compress_newpfd_opt(unsigned int *input, unsigned int *output, int size);
+int pfor_compress_hybrid(unsigned int *input, unsigned int *output, int size, int words);
+int pfor_select(unsigned int* p, int size);
+int pfor_select_opt(unsigned int* p, int size);
+int  pfor_encode(unsigned int** w, unsigned int* p, int num, int block_size);
 int pfor_decompress(unsigned int* input, unsigned int* output, int size);
-unsigned* pfor_decode(unsigned int* _p, unsigned int* _w, int flag);
+int pfor_decompress_sorted(unsigned int* input, unsigned int* output, int size, unsigned int base);
+unsigned* pfor_decode(unsigned int* _p, unsigned int* _w, int flag, int block_size);
+int pfor_skip(unsigned int* input, int size);
 
 #endif
@@ -0,0 +1,240 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// PForDelta for 64-bit integers (docIDs beyond 2^32, timestamps, offsets).
+//
+// A block uses the NewPFD layout of pfor_compress_newpfd, with 64-bit values:
+//   - a header word: b (bits 24..31), the bits of the exceptions high part
+//     (bits 16..23) and the number of exceptions (bits 0..15),
+//   - the low b bits of every integer, packed with pack64,
+//   - the positions of the exceptions, in the bits needed by a position,
+//   - the high part of the exceptions, the integer shifted right by b.
+// b can be any width up to 64. When it is at most 32 the integers are
+// unpacked with the 32-bit kernels of unpack[] and widened, so blocks of
+// small gaps decode as fast as 32-bit ones.
+//
+
+#include "pfordelta.h"
+#include "pfordelta64.h"
+#include "codec_stats.h"
+#include "delta.h"
+#include "pack.h"
+#include "unpack.h"
+
+extern const float FRAC;
+
+// Exceptions decoded at a time.
+#define PFOR64_CHUNK 256
+
+#define PFOR64_HEADER(b, hb, n) (((unsigned) (b) << 24) | ((unsigned) (hb) << 16) | (unsigned) (n))
+
+// Bits needed to store a position in a block.
+static inline int position_bits(int block_size) {
+  return (block_size > 1) ? 32 - __builtin_clz(block_size - 1) : 0;
+}
+
+// Words needed by n values of 'bits' bits.
+static inline int packed_words(int bits, int n) {
+  return (bits * n + 31) >> 5;
+}
+
+static inline int width64(unsigned long long x) {
+  return (x == 0) ? 0 : 64 - __builtin_clzll(x);
+}
+
+static int compress(unsigned long long *input, unsigned int *output, int size, int opt) {
+  unsigned long long stack[3 * PFOR_STACK_BLOCK];
+  unsigned long long* low = NULL;  // integers masked to b bits
+  unsigned long long* pos = NULL;  // positions of the exceptions
+  unsigned long long* high = NULL; // exceptions shifted right by b
+  int hist[65] = {0};
+  unsigned int* w = output + 1;
+  int i, b, best, hb, n, c, pb, s, words, best_words;
+
+  for (i = 0; i < size; i++)
+    hist[width64(input[i])]++;
+  // hist[i] becomes the number of integers needing more than i bits.
+  for (n = 0, i = 64; i >= 0; i--) {
+    c = hist[i];
+    hist[i] = n;
+    n += c;
+  }
+  for (hb = 64; (hb > 0) && (hist[hb - 1] == 0); hb--)
+    ;
+  pb = position_bits(size);
+
+  // Smallest b with at most FRAC * size exceptions, or with 'opt' the b of
+  // the smallest block, see pfor_compress_newpfd_opt.
+  best = 64;
+  best_words = size * 2;
+  for (b = 0; b < 64; b++) {
+    n = hist[b];
+    if (opt) {
+      words = ((b * size) >> 5) + packed_words(pb, n) + packed_words(hb - b, n);
+      if (words < best_words) {
+        best = b;
+        best_words = words;
+      }
+    } else if ((double) (n) <= FRAC * (double) (size)) {
+      best = b;
+      break;
+    }
+  }
+  b = best;
+
+  // Without room to split the integers, they are stored as they are.
+  if ((b < 64) && ((low = pfor_scratch(stack, sizeof(stack), 3 * size * sizeof(unsigned long long))) == NULL))
+    b = 64;
+
+  n = 0;
+  if (b < 64) {
+    pos = low + size;
+    high = pos + size;
+    for (i = 0; i < size; i++) {
+      if (input[i] >> b) {
+        pos[n] = i;
+        high[n++] = input[i] >> b;
+        low[i] = input[i] & ((1ULL << b) - 1);
+      } else {
+        low[i] = input[i];
+      }
+    }
+  }
+  hb = (n > 0) ? hb - b : 0;
+
+  s = ((b * size) >> 5) + packed_words(pb, n) + packed_words(hb, n);
+  for (i = 0; i < s; i++)
+    w[i] = 0;
+  pack64((b < 64) ? low : input, b, size, w);
+  w += (b * size) >> 5;
+  if (n > 0) {
+    pack64(pos, pb, n, w);
+    w += packed_words(pb, n);
+    pack64(high, hb, n, w);
+    w += packed_words(hb, n);
+  }
+  if (b < 64)
+    pfor_scratch_free(low, stack);
+
+  CODEC_STATS_ADD(pfor_blocks, 1);
+  CODEC_STATS_ADD(pfor_exceptions, n);
+  *output = PFOR64_HEADER(b, hb, n);
+  return w - output;
+}
+
+//
+// Compress a block of 64-bit integers
+// Parameters:
+//    input pointer to the array of integers to compress
+//    output pointer to the array of compressed integers
+//    size block size (a multiple of 32, up to PFOR_MAX_BLOCK_SIZE)
+// Returns:
+//    the number of 32-bits words used to compress the input
+//
+// pfor64_compress uses the smallest b leaving at most FRAC * size
+// exceptions, pfor64_compress_opt the b that gives the smallest block.
+int pfor64_compress(unsigned long long *input, unsigned int *output, int size) {
+  return compress(input, output, size, 0);
+}
+
+int pfor64_compress_opt(unsigned long long *input, unsigned int *output, int size) {
+  return compress(input, output, size, 1);
+}
+
+//
+// Compress a block of a sorted array of 64-bit integers, storing the
+// differences between consecutive integers. 'base' is the integer before
+// the block, 'opt' chooses pfor64_compress_opt.
+int pfor64_compress_sorted(unsigned long long *input, unsigned int *output, int size, unsigned long long base, int opt) {
+  unsigned long long stack[PFOR_STACK_BLOCK];
+  unsigned long long *gaps = pfor_scratch(stack, sizeof(stack), size * sizeof(unsigned long long));
+  int i, n;
+
+  if (gaps == NULL) {
+    // The gaps are stored as they are (b = 64), as pack64 writes them.
+    for (i = 0; i < size; base = input[i++]) {
+      output[1 + 2 * i] = (input[i] - base) >> 32;
+      output[2 + 2 * i] = (unsigned int) (input[i] - base);
+    }
+    *output = PFOR64_HEADER(64, 0, 0);
+    return 1 + 2 * size;
+  }
+  delta_encode64(input, gaps, size, base);
+  n = compress(gaps, output, size, opt);
+  pfor_scratch_free(gaps, stack);
+  return n;
+}
+
+//
+// Decompress a block of 64-bit integers
+// Parameters:
+//    input pointer to the compressed block
+//    output pointer to the array of integers
+//    size block size used to compress the input
+// Returns:
+//    the number of 32-bits consumed in input
+//
+int pfor64_decompress(unsigned int *input, unsigned long long *output, int size) {
+  unsigned int flag = *input;
+  int b = flag >> 24;
+  int hb = (flag >> 16) & 255;
+  int n = flag & 65535;
+  int pb = position_bits(size);
+  unsigned int* w = input + 1;
+  unsigned int* wh = w + ((b * size) >> 5) + packed_words(pb, n);
+  unsigned int low[PFOR_STACK_BLOCK];
+  unsigned long long pos[PFOR64_CHUNK];
+  unsigned long long high[PFOR64_CHUNK];
+  int i, j, c;
+
+  // Blocks larger than PFOR_STACK_BLOCK are unpacked and widened in chunks,
+  // and the exceptions patched PFOR64_CHUNK at a time; every chunk starts at
+  // a word, as it holds a multiple of 32 values.
+  if (b <= 32) {
+    for (j = 0; j < size; j += c) {
+      c = (size - j < PFOR_STACK_BLOCK) ? size - j : PFOR_STACK_BLOCK;
+      (unpack_table(c)[b])(low, w + ((b * j) >> 5), c);
+      for (i = 0; i < c; i++)
+        output[j + i] = low[i];
+    }
+  } else {
+    unpack64(output, w, b, size);
+  }
+  w += (b * size) >> 5;
+
+  for (j = 0; j < n; j += c) {
+    c = (n - j < PFOR64_CHUNK) ? n - j : PFOR64_CHUNK;
+    unpack64(pos, w + ((pb * j) >> 5), pb, c);
+    unpack64(high, wh + ((hb * j) >> 5), hb, c);
+    for (i = 0; i < c; i++)
+      output[pos[i]] |= high[i] << b;
+  }
+  return wh + packed_words(hb, n) - input;
+}
+
+//
+// Decompress a block compressed with pfor64_compress_sorted, 'base' is the
+// integer before the block.
+int pfor64_decompress_sorted(unsigned int *input, unsigned long long *output, int size, unsigned long long base) {
+  int n = pfor64_decompress(input, output, size);
+
+  delta_decode64(output, size, base);
+  return n;
+}
+
+//
+// Returns the number of 32-bits words of a block, without decoding it.
+int pfor64_skip(unsigned int *input, int size) {
+  unsigned int flag = *input;
+  int n = flag & 65535;
+
+  return 1 + (((flag >> 24) * size) >> 5) + packed_words(position_bits(size), n)
+         + packed_words((flag >> 16) & 255, n);
+}
@@ -0,0 +1,24 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// PForDelta for 64-bit integers, see pfordelta64.c. The compressed blocks are
+// arrays of 32-bit words, like the ones of pfordelta.h.
+
+#ifndef PFORDELTA64_H_
+#define PFORDELTA64_H_
+
+int pfor64_compress(unsigned long long *input, unsigned int *output, int size);
+int pfor64_compress_opt(unsigned long long *input, unsigned int *output, int size);
+int pfor64_compress_sorted(unsigned long long *input, unsigned int *output, int size, unsigned long long base, int opt);
+int pfor64_decompress(unsigned int *input, unsigned long long *output, int size);
+int pfor64_decompress_sorted(unsigned int *input, unsigned long long *output, int size, unsigned long long base);
+int pfor64_skip(unsigned int *input, int size);
+
+#endif /* PFORDELTA64_H_ */
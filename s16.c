@@ -47,10 +47,12 @@
 //   2. http://www2009.org/proceedings/pdf/p401.pdf 
 //
 // The maximum possible integer value Simple16 can encode is < 2^28 (this is 
-// dertermined by the Simple16 algorithm itself). Therefore, in order to use
-// Simple16, the application must write their own code to encode numbers in 
-// the range of [2^28, 2^32). A simple way is just write those numbers as 
-// 32-bit integers (that is, no compression for very big numbers). 
+// dertermined by the Simple16 algorithm itself). The _esc functions write
+// larger integers as an escape word, S16_ESCAPE (selector 15 with all its 28
+// bits set), followed by the integer in a 32-bit word. 2^28 - 1 is escaped
+// too, so the escape word never holds an integer. As every word is valid in
+// the original format, the escaped one is a different format, with its own
+// functions; the original functions keep reading and writing the old streams.
 //
 // Alternative implementations:
 //   * C++ http://code.google.com/p/poly-ir-toolkit/source/browse/trunk/src/compression_toolkit/s16_coding.cc
@@ -62,9 +64,15 @@
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include<immintrin.h>
+#endif
 #include"s16.h"
+#include"codec_stats.h"
+#include"delta.h"
 
-unsigned int cbits[16][28] = 
+const unsigned int cbits[16][28] = 
   { {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1},
     {2,2,2,2,2,2,2,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,0},
     {1,1,1,1,1,1,1,2,2,2,2,2,2,2,1,1,1,1,1,1,1,0,0,0,0,0,0,0},
@@ -82,7 +90,92 @@ unsigned int cbits[16][28] =
     {14,14,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
     {28,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0} };
 
-int s16_cnum[16] = {28, 21, 21, 21, 14, 9, 8, 7, 6, 6, 5, 5, 4, 3, 2, 1};
+const int s16_cnum[16] = {28, 21, 21, 21, 14, 9, 8, 7, 6, 6, 5, 5, 4, 3, 2, 1};
+
+// Decoding tables, built from cbits at startup: bit offset and mask of each
+// integer of a word, for each selector. They are padded to 32 entries with
+// mask 0 for the vectorized decoder.
+static unsigned int s16_shift[16][32] __attribute__((aligned(32)));
+static unsigned int s16_mask[16][32] __attribute__((aligned(32)));
+
+static int s16_decompress_table(unsigned int* input, unsigned int* output, int size);
+static int s16_decompress_table_esc(unsigned int* input, unsigned int* output, int size);
+static int s16_decompress_table_sorted(unsigned int* input, unsigned int* output, int size);
+static int s16_decompress_table_esc_sorted(unsigned int* input, unsigned int* output, int size);
+static inline int s16_compress_words(unsigned int* input, unsigned int* output, int size, int esc);
+static inline int s16_compress_sorted_words(unsigned int* input, unsigned int* output, int size, int esc);
+
+// Bulk decoders used by s16_decompress, s16_decompress_esc and their sorted
+// versions, the best ones for the CPU.
+static int (*s16_bulk)(unsigned int*, unsigned int*, int) = s16_decompress_table;
+static int (*s16_bulk_esc)(unsigned int*, unsigned int*, int) = s16_decompress_table_esc;
+static int (*s16_bulk_sorted)(unsigned int*, unsigned int*, int) = s16_decompress_table_sorted;
+static int (*s16_bulk_esc_sorted)(unsigned int*, unsigned int*, int) = s16_decompress_table_esc_sorted;
+
+// s16_fit[b][j] has bit k set when position j of a word with selector k can
+// hold an integer of b bits, or when selector k has less than j + 1 integers.
+static unsigned short s16_fit[33][28];
+
+static inline int s16_width(unsigned int x) {
+  return (x == 0) ? 0 : 32 - __builtin_clz(x);
+}
+
+// Chooses the selector for the next 'm' integers, given their bit widths:
+// the first selector (the one with more integers) where all of them fit.
+// The masks of the positions are and-ed until the lowest selector left does
+// not use the next positions, so each width is only looked up once.
+static inline int s16_select(unsigned char* width, unsigned int m) {
+  unsigned int mask = 0xFFFF;
+  unsigned int j, k;
+
+  if (m > 28)
+    m = 28;
+  for (j = 0; j < m; j++) {
+    mask &= s16_fit[width[j]][j];
+    k = __builtin_ctz(mask | 0x10000);
+    if ((k == 16) || (s16_cnum[k] <= (int) j + 1))
+      return k;
+  }
+  return __builtin_ctz(mask | 0x10000);
+}
+
+// Writes the word for selector k, or with 'esc' the escape and the integer
+// when nothing fits (k = 16), and moves *_w past them. Returns how many
+// integers it holds, 0 if nothing fits and there is no escape.
+static inline int s16_pack(unsigned int** _w, unsigned int* _p, int k, unsigned int m, int esc) {
+  unsigned int* w = *_w;
+  unsigned int _j, _m;
+
+  if (esc && ((k == 16) || ((k == 15) && (_p[0] == S16_ESCAPE >> 4)))) {
+    CODEC_STATS_ADD(s16_words, 2);
+    CODEC_STATS_ADD(s16_selector[15], 1);
+    w[0] = S16_ESCAPE;
+    w[1] = _p[0];
+    *_w += 2;
+    return 1;
+  }
+  if (k == 16)
+    return 0; // an integer >= 2^28, the original format cannot hold it
+
+  _m = (s16_cnum[k] < m) ? s16_cnum[k] : m;
+  CODEC_STATS_ADD(s16_words, 1);
+  CODEC_STATS_ADD(s16_selector[k], 1);
+  *w = (unsigned int) k << 28;
+  for (_j = 0; _j < _m; _j++)
+    *w |= _p[_j] << s16_shift[k][_j];
+  *_w += 1;
+  return _m;
+}
+
+// Encodes the next integers in one word (two for an escape), moving *_w past it.
+static inline int s16_encode_word(unsigned int** _w, unsigned int* _p, unsigned int m, int esc) {
+  unsigned char width[28];
+  unsigned int _j;
+
+  for (_j = 0; (_j < 28) && (_j < m); _j++)
+    width[_j] = s16_width(_p[_j]);
+  return s16_pack(_w, _p, s16_select(width, m), m, esc);
+}
 
 //
 // Compress an integer array using Simple16
@@ -91,7 +184,7 @@ int s16_cnum[16] = {28, 21, 21, 21, 14, 9, 8, 7, 6, 6, 5, 5, 4, 3, 2, 1};
 //    output pointer to the array of compressed integers
 //    size number of integers to compress
 // Returns:
-//    the number of compressed integers
+//    the number of compressed integers, -1 if an integer is >= 2^28
 //
 // Idea of compress algorithm:
 //
@@ -102,40 +195,99 @@ int s16_cnum[16] = {28, 21, 21, 21, 14, 9, 8, 7, 6, 6, 5, 5, 4, 3, 2, 1};
 //      - if no: do the next 21 numbers fits in an array of 7 integers of 1 bit and 7 integers 2 bits and 7 integers of 1 bit each?
 //      ... and so on .
 int s16_compress(unsigned int* input, unsigned int* output, int size) {
-  int left = size;
+  return s16_compress_words(input, output, size, 0);
+}
+
+//
+// Same as s16_compress, for any integer, in the escaped format.
+int s16_compress_esc(unsigned int* input, unsigned int* output, int size) {
+  return s16_compress_words(input, output, size, 1);
+}
+
+static inline int s16_compress_words(unsigned int* input, unsigned int* output, int size, int esc) {
+  unsigned char width[256];
   unsigned int* tmp = output;
-  int ret;
+  int have = 0; // widths in the buffer
+  int pos = 0;  // integers already encoded, relative to the buffer
+  int i, n;
 
-  while (left > 0) {
-    ret = s16_encode(tmp, input, left);
-    input += ret;
-    left -= ret;
-    tmp++;
+  while (pos < have || size > 0) {
+    // The bit width of each integer is computed once, keeping 28 ahead.
+    if ((have - pos < 28) && (size > 0)) {
+      memmove(width, width + pos, have - pos);
+      have -= pos;
+      pos = 0;
+      n = (256 - have < size) ? 256 - have : size;
+      for (i = 0; i < n; i++)
+        width[have + i] = s16_width(input[have + i]);
+      have += n;
+      size -= n;
+    }
+    n = s16_pack(&tmp, input, s16_select(width + pos, have - pos), have - pos, esc);
+    if (n == 0)
+      return -1;
+    input += n;
+    pos += n;
   }
 
   return tmp - output;
 }
 
-int s16_encode(unsigned int* _w, unsigned int* _p, unsigned int m) {
-  unsigned int _k, _j, _m, _o;
+//
+// Compress a sorted integer array using Simple16, storing the differences
+// between consecutive integers (the first one is stored as is).
+// The gaps are computed in a small buffer, the input is not modified.
+// Parameters:
+//    input pointer to the sorted array of integers to compress
+//    output pointer to the array of compressed integers
+//    size number of integers to compress
+// Returns:
+//    the number of compressed integers, -1 if a gap is >= 2^28
+//
+int s16_compress_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_compress_sorted_words(input, output, size, 0);
+}
 
-  for (_k = 0; _k < 16; _k++) {
-    (*_w) = _k << 28;
-    _m = (s16_cnum[_k] < m) ? s16_cnum[_k] : m;
+//
+// Same as s16_compress_sorted, for any gap, in the escaped format.
+int s16_compress_esc_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_compress_sorted_words(input, output, size, 1);
+}
 
-    for (_j = 0, _o = 0; (_j < _m) && (*(_p + _j) < (unsigned int) (1 << cbits[_k][_j]));) {
-      (*_w) += ((*(_p + _j)) << _o);
-      _o += cbits[_k][_j];
-      _j++;
-    }
-    if (_j == _m) {
-      (_p) += _m;
-      (_w)++;
-      break;
+static inline int s16_compress_sorted_words(unsigned int* input, unsigned int* output, int size, int esc) {
+  unsigned int gaps[256];
+  unsigned int* tmp = output;
+  unsigned int base = 0;
+  int have = 0; // gaps in the buffer
+  int pos = 0;  // gaps already encoded
+  int done = 0; // integers of the input moved to the buffer
+  int n;
+
+  while (done < size || pos < have) {
+    // Keep at least 28 gaps ahead, so the words are the same as for the whole array.
+    if ((have - pos < 28) && (done < size)) {
+      memmove(gaps, gaps + pos, (have - pos) * sizeof(unsigned int));
+      have -= pos;
+      pos = 0;
+      n = (256 - have < size - done) ? 256 - have : size - done;
+      delta_encode(input + done, gaps + have, n, base);
+      base = input[done + n - 1];
+      have += n;
+      done += n;
     }
+    n = s16_encode_word(&tmp, gaps + pos, have - pos, esc);
+    if (n == 0)
+      return -1;
+    pos += n;
   }
 
-  return _m;
+  return tmp - output;
+}
+
+// Encodes the next integers in one word, returns how many, 0 if the first
+// one is >= 2^28.
+int s16_encode(unsigned int* _w, unsigned int* _p, unsigned int m) {
+  return s16_encode_word(&_w, _p, m, 0);
 }
 
 
@@ -148,22 +300,187 @@ int s16_encode(unsigned int* _w, unsigned int* _p, unsigned int m) {
 // Returns:
 //    the number of processed integers
 //
+// It decodes with the lookup tables s16_shift and s16_mask instead of the
+// switch of s16_decode, and writes exactly 'size' integers.
+//
 int s16_decompress(unsigned int* input, unsigned int* output, int size) {
-  unsigned int *_p = output;
-  int num;
+  return s16_bulk(input, output, size);
+}
+
+//
+// Same as s16_decompress, for an array compressed with s16_compress_esc.
+int s16_decompress_esc(unsigned int* input, unsigned int* output, int size) {
+  return s16_bulk_esc(input, output, size);
+}
+
+// Table driven version: no branch on the selector, and never more than 'size'
+// integers written. With 'esc' it reads the escaped format, with 'sorted' it
+// writes the running sum of the gaps, starting from 'base'.
+static inline int s16_table_words(unsigned int* input, unsigned int* output, int size, int esc, int sorted, unsigned int base) {
   unsigned int* tmp = input;
-  int left = size;
- 
-  while (left > 0) {
-    num = s16_decode(tmp, _p);
-    _p += num;
-    left -= num;
-    tmp++;
+  unsigned int w, x;
+  int k, j, n;
+
+  while (size > 0) {
+    w = *tmp++;
+    if (esc && (w == S16_ESCAPE)) {
+      x = *tmp++;
+      *output++ = sorted ? (base += x) : x;
+      size--;
+      continue;
+    }
+    k = w >> 28;
+    n = (s16_cnum[k] < size) ? s16_cnum[k] : size;
+    for (j = 0; j < n; j++) {
+      x = (w >> s16_shift[k][j]) & s16_mask[k][j];
+      output[j] = sorted ? (base += x) : x;
+    }
+    output += n;
+    size -= n;
   }
 
   return tmp - input;
 }
 
+static int s16_decompress_table(unsigned int* input, unsigned int* output, int size) {
+  return s16_table_words(input, output, size, 0, 0, 0);
+}
+
+static int s16_decompress_table_esc(unsigned int* input, unsigned int* output, int size) {
+  return s16_table_words(input, output, size, 1, 0, 0);
+}
+
+static int s16_decompress_table_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_table_words(input, output, size, 0, 1, 0);
+}
+
+static int s16_decompress_table_esc_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_table_words(input, output, size, 1, 1, 0);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+// AVX2 version: the word is broadcast and the 32 entries of the tables are
+// applied with four variable shifts and masks, whatever the selector is.
+// That writes 32 integers per word, so the last ones are left to the table
+// driven version, which writes exactly up to 'size'.
+// With 'sorted' the prefix sum is taken in the registers before the store:
+// the entries past the last integer of the word are 0, so the last lane holds
+// the running sum the next word starts from.
+__attribute__((target("avx2")))
+static inline int s16_avx2_words(unsigned int* input, unsigned int* output, int size, int esc, int sorted) {
+  unsigned int* tmp = input;
+  __m256i carry = _mm256_setzero_si256();
+  __m256i last = _mm256_set1_epi32(7);
+  __m256i v, x;
+  int k, j;
+
+  while (size >= 32) {
+    if (esc && (*tmp == S16_ESCAPE)) {
+      *output = sorted ? (unsigned int) _mm256_cvtsi256_si32(carry) + tmp[1] : tmp[1];
+      if (sorted)
+        carry = _mm256_set1_epi32(*output);
+      output++;
+      size--;
+      tmp += 2;
+      continue;
+    }
+    v = _mm256_set1_epi32(*tmp);
+    k = *tmp++ >> 28;
+    for (j = 0; j < (sorted ? s16_cnum[k] : 32); j += 8) {
+      x = _mm256_and_si256(_mm256_srlv_epi32(v, _mm256_load_si256((const __m256i*) (s16_shift[k] + j))),
+                           _mm256_load_si256((const __m256i*) (s16_mask[k] + j)));
+      if (sorted) {
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        x = _mm256_add_epi32(x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF));
+        x = _mm256_add_epi32(x, carry);
+        carry = _mm256_permutevar8x32_epi32(x, last);
+      }
+      _mm256_storeu_si256((__m256i*) (output + j), x);
+    }
+    output += s16_cnum[k];
+    size -= s16_cnum[k];
+  }
+
+  return (tmp - input) + s16_table_words(tmp, output, size, esc, sorted, _mm256_cvtsi256_si32(carry));
+}
+
+__attribute__((target("avx2")))
+static int s16_decompress_avx2(unsigned int* input, unsigned int* output, int size) {
+  return s16_avx2_words(input, output, size, 0, 0);
+}
+
+__attribute__((target("avx2")))
+static int s16_decompress_avx2_esc(unsigned int* input, unsigned int* output, int size) {
+  return s16_avx2_words(input, output, size, 1, 0);
+}
+
+__attribute__((target("avx2")))
+static int s16_decompress_avx2_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_avx2_words(input, output, size, 0, 1);
+}
+
+__attribute__((target("avx2")))
+static int s16_decompress_avx2_esc_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_avx2_words(input, output, size, 1, 1);
+}
+
+#endif
+
+__attribute__((constructor))
+static void s16_init(void) {
+  int k, j, o, b;
+
+  for (k = 0; k < 16; k++) {
+    for (j = 0, o = 0; j < s16_cnum[k]; j++) {
+      s16_shift[k][j] = o;
+      s16_mask[k][j] = (1u << cbits[k][j]) - 1;
+      o += cbits[k][j];
+    }
+    for (b = 0; b <= 32; b++) {
+      for (j = 0; j < 28; j++) {
+        if ((j >= s16_cnum[k]) || (b <= (int) cbits[k][j]))
+          s16_fit[b][j] |= 1 << k;
+      }
+    }
+  }
+
+  s16_bulk = s16_decompress_table;
+  s16_bulk_esc = s16_decompress_table_esc;
+  s16_bulk_sorted = s16_decompress_table_sorted;
+  s16_bulk_esc_sorted = s16_decompress_table_esc_sorted;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if ((getenv("CODEC_SCALAR") == NULL) && __builtin_cpu_supports("avx2")) {
+    s16_bulk = s16_decompress_avx2;
+    s16_bulk_esc = s16_decompress_avx2_esc;
+    s16_bulk_sorted = s16_decompress_avx2_sorted;
+    s16_bulk_esc_sorted = s16_decompress_avx2_esc_sorted;
+  }
+#endif
+}
+
+//
+// Decompress an integer array compressed with s16_compress_sorted. The gaps
+// are added up as each word is decoded, so the output is written once.
+// Parameters:
+//    input pointer to the array of compressed integers to decompress
+//    output pointer to the array of integers
+//    size number of integers to decompress
+// Returns:
+//    the number of processed integers
+//
+int s16_decompress_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_bulk_sorted(input, output, size);
+}
+
+//
+// Same as s16_decompress_sorted, for an array compressed with s16_compress_esc_sorted.
+int s16_decompress_esc_sorted(unsigned int* input, unsigned int* output, int size) {
+  return s16_bulk_esc_sorted(input, output, size);
+}
+
 int s16_decode(unsigned int *_w, unsigned int *_p) {
   int _k = (*_w) >> 28;
   switch (_k) {
@@ -525,3 +842,142 @@ int s16_decode(unsigned int *_w, unsigned int *_p) {
   return s16_cnum[_k];
 }
 
+
+// 64-bit integers: the integers < 2^28 - 1 are coded as in the 32-bit
+// functions, the larger ones as S16_ESCAPE followed by two words, the high
+// and low halves of the integer.
+
+// Encodes the next integers in one word (three for an escape), moving *_w past it.
+static inline int s16_encode_word64(unsigned int** _w, unsigned long long* _p, unsigned int m) {
+  unsigned char width[28];
+  unsigned int low[28];
+  unsigned int* w = *_w;
+  unsigned int _j;
+  int k;
+
+  for (_j = 0; (_j < 28) && (_j < m); _j++) {
+    low[_j] = (unsigned int) _p[_j];
+    width[_j] = (_p[_j] >> 32) ? 32 : s16_width(low[_j]); // 32 fits no selector
+  }
+  k = s16_select(width, m);
+  if ((k == 16) || ((k == 15) && (_p[0] == S16_ESCAPE >> 4))) {
+    CODEC_STATS_ADD(s16_words, 3);
+    CODEC_STATS_ADD(s16_selector[15], 1);
+    w[0] = S16_ESCAPE;
+    w[1] = (unsigned int) (_p[0] >> 32);
+    w[2] = (unsigned int) _p[0];
+    *_w += 3;
+    return 1;
+  }
+  return s16_pack(_w, low, k, m, 1);
+}
+
+// Decodes one word (three for an escape), writing at most 'size' integers.
+static inline int s16_decode_word64(unsigned int** _w, unsigned long long* _p, int size) {
+  unsigned int w = *(*_w)++;
+  int k, j, n;
+
+  if (w == S16_ESCAPE) {
+    *_p = ((unsigned long long) (*_w)[0] << 32) | (*_w)[1];
+    *_w += 2;
+    return 1;
+  }
+  k = w >> 28;
+  n = (s16_cnum[k] < size) ? s16_cnum[k] : size;
+  for (j = 0; j < n; j++)
+    _p[j] = (w >> s16_shift[k][j]) & s16_mask[k][j];
+  return n;
+}
+
+//
+// Compress an array of 64-bit integers using Simple16
+// Parameters:
+//    input pointer to the array of integers to compress
+//    output pointer to the array of compressed integers
+//    size number of integers to compress
+// Returns:
+//    the number of 32-bits words used
+//
+int s16_compress64(unsigned long long* input, unsigned int* output, int size) {
+  unsigned int* tmp = output;
+  int n;
+
+  while (size > 0) {
+    n = s16_encode_word64(&tmp, input, size);
+    input += n;
+    size -= n;
+  }
+
+  return tmp - output;
+}
+
+//
+// Compress a sorted array of 64-bit integers using Simple16, storing the
+// differences between consecutive integers. The input is not modified.
+int s16_compress64_sorted(unsigned long long* input, unsigned int* output, int size) {
+  unsigned long long gaps[256];
+  unsigned int* tmp = output;
+  unsigned long long base = 0;
+  int have = 0; // gaps in the buffer
+  int pos = 0;  // gaps already encoded
+  int done = 0; // integers of the input moved to the buffer
+  int n;
+
+  while (done < size || pos < have) {
+    if ((have - pos < 28) && (done < size)) {
+      memmove(gaps, gaps + pos, (have - pos) * sizeof(unsigned long long));
+      have -= pos;
+      pos = 0;
+      n = (256 - have < size - done) ? 256 - have : size - done;
+      delta_encode64(input + done, gaps + have, n, base);
+      base = input[done + n - 1];
+      have += n;
+      done += n;
+    }
+    pos += s16_encode_word64(&tmp, gaps + pos, have - pos);
+  }
+
+  return tmp - output;
+}
+
+//
+// Decompress an array of 64-bit integers using Simple16
+// Parameters:
+//    input pointer to the array of compressed integers to decompress
+//    output pointer to the array of integers
+//    size number of integers to decompress
+// Returns:
+//    the number of 32-bits words consumed
+//
+int s16_decompress64(unsigned int* input, unsigned long long* output, int size) {
+  unsigned int* tmp = input;
+  int n;
+
+  while (size > 0) {
+    n = s16_decode_word64(&tmp, output, size);
+    output += n;
+    size -= n;
+  }
+
+  return tmp - input;
+}
+
+//
+// Decompress an array compressed with s16_compress64_sorted, adding up the
+// gaps every 128 integers or so.
+int s16_decompress64_sorted(unsigned int* input, unsigned long long* output, int size) {
+  unsigned int* tmp = input;
+  unsigned long long base = 0;
+  int summed = 0;
+  int done = 0;
+
+  while (done < size) {
+    done += s16_decode_word64(&tmp, output + done, size - done);
+    if ((done - summed >= 128) || (done == size)) {
+      base = delta_decode64(output + summed, done - summed, base);
+      summed = done;
+    }
+  }
+
+  return tmp - input;
+}
@@ -43,9 +43,31 @@
 #ifndef S16_H_
 #define S16_H_
 
+// Original format: the integers must be < 2^28. The compressors return -1,
+// and s16_encode 0, on one that is not.
 int s16_compress(unsigned int*, unsigned int*, int);
+int s16_compress_sorted(unsigned int*, unsigned int*, int);
 int s16_encode(unsigned int*, unsigned int*, unsigned int);
 int s16_decompress(unsigned int*, unsigned int*, int);
+int s16_decompress_sorted(unsigned int*, unsigned int*, int);
 int s16_decode(unsigned int*, unsigned int*);
 
+// Word written before an integer >= 2^28 - 1, which follows it as is, in the
+// escaped format. That word is a valid word of the original format, so each
+// format must be decoded with its own functions.
+#define S16_ESCAPE 0xFFFFFFFFu
+
+// Escaped format: any integer, those >= 2^28 - 1 take two words.
+int s16_compress_esc(unsigned int*, unsigned int*, int);
+int s16_compress_esc_sorted(unsigned int*, unsigned int*, int);
+int s16_decompress_esc(unsigned int*, unsigned int*, int);
+int s16_decompress_esc_sorted(unsigned int*, unsigned int*, int);
+
+// 64-bit integers, an integer >= 2^28 - 1 takes S16_ESCAPE and two words
+// (high and low halves). They return or consume 32-bit words.
+int s16_compress64(unsigned long long*, unsigned int*, int);
+int s16_compress64_sorted(unsigned long long*, unsigned int*, int);
+int s16_decompress64(unsigned int*, unsigned long long*, int);
+int s16_decompress64_sorted(unsigned int*, unsigned long long*, int);
+
 #endif
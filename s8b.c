@@ -0,0 +1,258 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// This is an implementation of Simple-8b for 32-bit integers: like Simple16,
+// each word holds as many integers as fit, but the words have 64 bits, a
+// 4-bit selector in the top bits and 60 bits of payload, filled from the
+// least significant bit.
+//
+//   selector   0    1   2   3   4   5   6   7   8   9  10  11  12  13  14  15
+//   integers 240  120  60  30  20  15  12  10   8   7   6   5   4   3   2   1
+//   bits       -    -   1   2   3   4   5   6   7   8  10  12  15  20  30  60
+//
+// Selectors 0 and 1 are runs: 240 or 120 copies of the integer stored in the
+// payload, so long runs of 1s (dense lists of d-gaps) or 0s take one word.
+// Any 32-bit integer fits in selector 15, there is no escape.
+//
+// From: V. N. Anh and A. Moffat, Index compression using 64-bit words.
+//   http://dx.doi.org/10.1002/spe.948
+//
+
+#include<string.h>
+#include"s8b.h"
+#include"delta.h"
+
+const int s8b_cnum[16] = {240, 120, 60, 30, 20, 15, 12, 10, 8, 7, 6, 5, 4, 3, 2, 1};
+const int s8b_cbits[16] = {0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 15, 20, 30, 60};
+
+#define S8B_PAYLOAD 0x0FFFFFFFFFFFFFFFULL
+
+static inline int s8b_width(unsigned int x) {
+  return (x == 0) ? 0 : 32 - __builtin_clz(x);
+}
+
+// Chooses the selector for the next 'm' integers: the first one where all
+// of them fit, or all of the last 'm' < s8b_cnum[k] integers.
+static inline int s8b_select(unsigned int* _p, unsigned int m) {
+  unsigned int j, n;
+  int k;
+
+  // Runs of the first integer.
+  n = (m < 240) ? m : 240;
+  for (j = 1; (j < n) && (_p[j] == _p[0]); j++)
+    ;
+  if (j == n)
+    return 0;
+  if (j >= 120)
+    return 1;
+
+  // The widths grow with the selector, so the integers that fit one also fit
+  // the next ones, and each integer is looked at once.
+  for (j = 0, k = 2; k < 15; k++) {
+    n = ((unsigned) s8b_cnum[k] < m) ? (unsigned) s8b_cnum[k] : m;
+    while ((j < n) && (s8b_width(_p[j]) <= s8b_cbits[k]))
+      j++;
+    // j can be past n, when the previous selector held more integers.
+    if (j >= n)
+      return k;
+  }
+  return 15;
+}
+
+// Writes the word for selector k, returns how many integers it holds.
+static inline int s8b_pack(unsigned long long* _w, unsigned int* _p, int k, unsigned int m) {
+  unsigned int _j, _m;
+
+  _m = ((unsigned) s8b_cnum[k] < m) ? (unsigned) s8b_cnum[k] : m;
+  *_w = (unsigned long long) k << 60;
+  if (k < 2) {
+    *_w |= _p[0];
+  } else {
+    for (_j = 0; _j < _m; _j++)
+      *_w |= (unsigned long long) _p[_j] << (_j * s8b_cbits[k]);
+  }
+  return _m;
+}
+
+// Encodes the next integers in one word, returns how many.
+int s8b_encode(unsigned long long* _w, unsigned int* _p, unsigned int m) {
+  return s8b_pack(_w, _p, s8b_select(_p, m), m);
+}
+
+//
+// Compress an integer array using Simple-8b
+// Parameters:
+//    input pointer to the array of integers to compress
+//    output pointer to the array of compressed 64-bit words
+//    size number of integers to compress
+// Returns:
+//    the number of 64-bit words used
+//
+int s8b_compress(unsigned int* input, unsigned long long* output, int size) {
+  unsigned long long* tmp = output;
+  int n;
+
+  while (size > 0) {
+    n = s8b_encode(tmp++, input, size);
+    input += n;
+    size -= n;
+  }
+
+  return tmp - output;
+}
+
+//
+// Compress a sorted integer array using Simple-8b, storing the differences
+// between consecutive integers (the first one is stored as is).
+// The gaps are computed in a small buffer, the input is not modified.
+// Parameters:
+//    input pointer to the sorted array of integers to compress
+//    output pointer to the array of compressed 64-bit words
+//    size number of integers to compress
+// Returns:
+//    the number of 64-bit words used
+//
+int s8b_compress_sorted(unsigned int* input, unsigned long long* output, int size) {
+  unsigned int gaps[1024];
+  unsigned long long* tmp = output;
+  unsigned int base = 0;
+  int have = 0; // gaps in the buffer
+  int pos = 0;  // gaps already encoded
+  int done = 0; // integers of the input moved to the buffer
+  int n;
+
+  while (done < size || pos < have) {
+    // Keep at least 240 gaps ahead, so the words are the same as for the whole array.
+    if ((have - pos < 240) && (done < size)) {
+      memmove(gaps, gaps + pos, (have - pos) * sizeof(unsigned int));
+      have -= pos;
+      pos = 0;
+      n = (1024 - have < size - done) ? 1024 - have : size - done;
+      delta_encode(input + done, gaps + have, n, base);
+      base = input[done + n - 1];
+      have += n;
+      done += n;
+    }
+    pos += s8b_encode(tmp++, gaps + pos, have - pos);
+  }
+
+  return tmp - output;
+}
+
+// Unpacks the N integers of B bits of word w, the constants let the
+// compiler unroll each case.
+#define S8B_UNPACK(N, B)                                  \
+  for (j = 0; j < (N); j++)                               \
+    _p[j] = (unsigned int) ((w >> (j * (B))) & ((1ULL << (B)) - 1));
+
+// Decodes a whole word, always writing s8b_cnum[k] integers. Returns how many.
+int s8b_decode(unsigned long long* _w, unsigned int* _p) {
+  unsigned long long w = *_w;
+  int j;
+
+  switch (w >> 60) {
+    case 0:
+      for (j = 0; j < 240; j++)
+        _p[j] = (unsigned int) (w & S8B_PAYLOAD);
+      return 240;
+    case 1:
+      for (j = 0; j < 120; j++)
+        _p[j] = (unsigned int) (w & S8B_PAYLOAD);
+      return 120;
+    case 2: S8B_UNPACK(60, 1); return 60;
+    case 3: S8B_UNPACK(30, 2); return 30;
+    case 4: S8B_UNPACK(20, 3); return 20;
+    case 5: S8B_UNPACK(15, 4); return 15;
+    case 6: S8B_UNPACK(12, 5); return 12;
+    case 7: S8B_UNPACK(10, 6); return 10;
+    case 8: S8B_UNPACK(8, 7); return 8;
+    case 9: S8B_UNPACK(7, 8); return 7;
+    case 10: S8B_UNPACK(6, 10); return 6;
+    case 11: S8B_UNPACK(5, 12); return 5;
+    case 12: S8B_UNPACK(4, 15); return 4;
+    case 13: S8B_UNPACK(3, 20); return 3;
+    case 14: S8B_UNPACK(2, 30); return 2;
+    default: _p[0] = (unsigned int) w; return 1;
+  }
+}
+
+// Decodes the last integers one by one, never writing more than 'size'.
+static int s8b_decode_tail(unsigned long long* input, unsigned int* output, int size) {
+  unsigned long long* tmp = input;
+  unsigned long long w;
+  int k, j, n;
+
+  while (size > 0) {
+    w = *tmp++;
+    k = w >> 60;
+    n = (s8b_cnum[k] < size) ? s8b_cnum[k] : size;
+    for (j = 0; j < n; j++)
+      output[j] = (k < 2) ? (unsigned int) (w & S8B_PAYLOAD)
+                          : (unsigned int) ((w >> (j * s8b_cbits[k])) & ((1ULL << s8b_cbits[k]) - 1));
+    output += n;
+    size -= n;
+  }
+
+  return tmp - input;
+}
+
+//
+// Decompress an integer array using Simple-8b
+// Parameters:
+//    input pointer to the array of compressed 64-bit words
+//    output pointer to the array of integers
+//    size number of integers to decompress
+// Returns:
+//    the number of 64-bit words consumed
+//
+// It writes exactly 'size' integers: the whole words are decoded while
+// there is room for the largest one, the rest with s8b_decode_tail.
+//
+int s8b_decompress(unsigned long long* input, unsigned int* output, int size) {
+  unsigned long long* tmp = input;
+  int n;
+
+  while (size >= 240) {
+    n = s8b_decode(tmp++, output);
+    output += n;
+    size -= n;
+  }
+
+  return (tmp - input) + s8b_decode_tail(tmp, output, size);
+}
+
+//
+// Decompress an integer array compressed with s8b_compress_sorted.
+// The gaps are added up every 256 integers or so, while they are in cache.
+// Parameters:
+//    input pointer to the array of compressed 64-bit words
+//    output pointer to the array of integers
+//    size number of integers to decompress
+// Returns:
+//    the number of 64-bit words consumed
+//
+int s8b_decompress_sorted(unsigned long long* input, unsigned int* output, int size) {
+  unsigned long long* tmp = input;
+  unsigned int base = 0;
+  int summed = 0;
+  int done = 0;
+
+  while (size - done >= 240) {
+    done += s8b_decode(tmp++, output + done);
+    if (done - summed >= 256) {
+      base = delta_decode(output + summed, done - summed, base);
+      summed = done;
+    }
+  }
+  tmp += s8b_decode_tail(tmp, output + done, size - done);
+  delta_decode(output + summed, size - summed, base);
+
+  return tmp - input;
+}
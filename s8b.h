@@ -0,0 +1,22 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+#ifndef S8B_H_
+#define S8B_H_
+
+// Same interface as s16.h, the compressed arrays are made of 64-bit words
+// and the functions return or consume 64-bit words.
+int s8b_compress(unsigned int*, unsigned long long*, int);
+int s8b_compress_sorted(unsigned int*, unsigned long long*, int);
+int s8b_encode(unsigned long long*, unsigned int*, unsigned int);
+int s8b_decompress(unsigned long long*, unsigned int*, int);
+int s8b_decompress_sorted(unsigned long long*, unsigned int*, int);
+int s8b_decode(unsigned long long*, unsigned int*);
+
+#endif
@@ -43,6 +43,25 @@
 #ifndef UNPACK_H_
 #define UNPACK_H_
 
+// Block sizes with their own kernels, see unpack_table. Each one adds about
+// 100 functions, so list only the ones in use, for instance building with
+//   make UNPACK_SIZES="-D'UNPACK_BLOCK_SIZES(X)=X(128) X(256)'"
+#ifndef UNPACK_BLOCK_SIZES
+#define UNPACK_BLOCK_SIZES(X) X(128)
+#endif
+
+#define UNPACK_COUNT(bs) + 1
+#define UNPACK_NUM_BLOCK_SIZES (0 UNPACK_BLOCK_SIZES(UNPACK_COUNT))
+
+// X(b, arg) for every b from 0 to 32.
+#define UNPACK_WIDTHS(X, arg)                                           \
+  X(0, arg) X(1, arg) X(2, arg) X(3, arg) X(4, arg) X(5, arg) X(6, arg)   \
+  X(7, arg) X(8, arg) X(9, arg) X(10, arg) X(11, arg) X(12, arg)         \
+  X(13, arg) X(14, arg) X(15, arg) X(16, arg) X(17, arg) X(18, arg)      \
+  X(19, arg) X(20, arg) X(21, arg) X(22, arg) X(23, arg) X(24, arg)      \
+  X(25, arg) X(26, arg) X(27, arg) X(28, arg) X(29, arg) X(30, arg)      \
+  X(31, arg) X(32, arg)
+
 void unpack0(unsigned int* p, unsigned int* w, int BS);
 void unpack1(unsigned int* p, unsigned int* w, int BS);
 void unpack2(unsigned int* p, unsigned int* w, int BS);
@@ -57,11 +76,38 @@ void unpack10(unsigned int* p, unsigned int* w, int BS);
 void unpack11(unsigned int* p, unsigned int* w, int BS);
 void unpack12(unsigned int* p, unsigned int* w, int BS);
 void unpack13(unsigned int* p, unsigned int* w, int BS);
+void unpack14(unsigned int* p, unsigned int* w, int BS);
+void unpack15(unsigned int* p, unsigned int* w, int BS);
 void unpack16(unsigned int* p, unsigned int* w, int BS);
+void unpack17(unsigned int* p, unsigned int* w, int BS);
+void unpack18(unsigned int* p, unsigned int* w, int BS);
+void unpack19(unsigned int* p, unsigned int* w, int BS);
 void unpack20(unsigned int* p, unsigned int* w, int BS);
+void unpack21(unsigned int* p, unsigned int* w, int BS);
+void unpack22(unsigned int* p, unsigned int* w, int BS);
+void unpack23(unsigned int* p, unsigned int* w, int BS);
+void unpack24(unsigned int* p, unsigned int* w, int BS);
+void unpack25(unsigned int* p, unsigned int* w, int BS);
+void unpack26(unsigned int* p, unsigned int* w, int BS);
+void unpack27(unsigned int* p, unsigned int* w, int BS);
+void unpack28(unsigned int* p, unsigned int* w, int BS);
+void unpack29(unsigned int* p, unsigned int* w, int BS);
+void unpack30(unsigned int* p, unsigned int* w, int BS);
+void unpack31(unsigned int* p, unsigned int* w, int BS);
 void unpack32(unsigned int* p, unsigned int* w, int BS);
 
+// Any width up to 64 bits, for the integers written by pack64.
+void unpack64(unsigned long long* p, unsigned int* w, int b, int n);
+
 // Pointer to a function
 typedef void (*pf)(unsigned int* p, unsigned int* w, int BS);
 
+// The kernels indexed by b: unpack[] for any BS (a multiple of 32), and
+// unpack_fixed[i] for the i-th size of UNPACK_BLOCK_SIZES only.
+extern pf unpack[33];
+extern pf unpack_fixed[UNPACK_NUM_BLOCK_SIZES][33];
+
+// unpack_fixed[i] if BS is the i-th size of UNPACK_BLOCK_SIZES, or unpack.
+pf* unpack_table(int BS);
+
 #endif /* UNPACK_H_ */
@@ -0,0 +1,196 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// Vectorized unpack functions.
+//
+// The packed format stores every b-bit value MSB first, so value i starts at
+// bit i*b of the stream, where bit 0 is the most significant bit of the first
+// word. The kernels decode four values at a time (eight with AVX2):
+//   1. load the 16 bytes window holding the four values,
+//   2. gather with a byte shuffle the 4 bytes that contain each value, in
+//      big-endian order, so the value ends up near the top of its lane,
+//   3. shift each lane left by the offset of the value inside its first byte,
+//   4. shift all lanes right by 32 - b.
+// The shuffle masks and shifts only depend on b and on the position of the
+// group inside a 32 integers chunk, so they are computed once at startup.
+//
+// A value must fit in the 4 bytes gathered for its lane, that is, it works
+// for b <= 25; wider values keep the scalar kernels. The kernels for 0 and 32
+// bits are a fill and a copy, the compiler already vectorizes the scalar
+// versions.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "unpack.h"
+#include "unpack_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define SIMD_MAX_B 25
+
+// Tables per b and per group of 4 integers in a chunk of 32 integers
+static unsigned char shuf[SIMD_MAX_B + 1][8][16] __attribute__((aligned(32))); // byte shuffle
+static unsigned int shl[SIMD_MAX_B + 1][8][4] __attribute__((aligned(32)));    // shift count (AVX2)
+static unsigned int mul[SIMD_MAX_B + 1][8][4] __attribute__((aligned(32)));    // 1 << shift (SSE4.1)
+static int window[SIMD_MAX_B + 1][8]; // first word of the 16 bytes window
+
+// Words read from a chunk, may be > b: the window of the last group.
+#define SIMD_REACH(b) (((28 * (b)) >> 5) + 4)
+
+// X(b, arg) for every b the kernels handle.
+#define SIMD_WIDTHS(X, arg)                                             \
+  X(1, arg) X(2, arg) X(3, arg) X(4, arg) X(5, arg) X(6, arg) X(7, arg)   \
+  X(8, arg) X(9, arg) X(10, arg) X(11, arg) X(12, arg) X(13, arg)        \
+  X(14, arg) X(15, arg) X(16, arg) X(17, arg) X(18, arg) X(19, arg)      \
+  X(20, arg) X(21, arg) X(22, arg) X(23, arg) X(24, arg) X(25, arg)
+
+static void init_tables(void) {
+  int b, g, j, l, r, s;
+
+  for (b = 1; b <= SIMD_MAX_B; b++) {
+    for (g = 0; g < 8; g++) {
+      window[b][g] = (4 * g * b) >> 5;
+      for (j = 0; j < 4; j++) {
+        r = (4 * g + j) * b - (window[b][g] << 5); // first bit of the value in the window
+        for (l = 0; l < 4; l++) {
+          s = (r >> 3) + 3 - l;                     // byte of the big-endian stream
+          shuf[b][g][4 * j + l] = ((s >> 2) << 2) + 3 - (s & 3); // byte in memory
+        }
+        shl[b][g][j] = r & 7;
+        mul[b][g][j] = 1u << (r & 7);
+      }
+    }
+  }
+}
+
+__attribute__((target("sse4.1")))
+static inline void unpack_chunk_sse(unsigned int* p, const unsigned int* w, const int b) {
+  const __m128i count = _mm_cvtsi32_si128(32 - b);
+  __m128i v;
+  int g;
+
+  for (g = 0; g < 8; g++) {
+    v = _mm_loadu_si128((const __m128i*) (w + window[b][g]));
+    v = _mm_shuffle_epi8(v, _mm_load_si128((const __m128i*) shuf[b][g]));
+    v = _mm_mullo_epi32(v, _mm_load_si128((const __m128i*) mul[b][g]));
+    _mm_storeu_si128((__m128i*) (p + 4 * g), _mm_srl_epi32(v, count));
+  }
+}
+
+__attribute__((target("avx2")))
+static inline void unpack_chunk_avx2(unsigned int* p, const unsigned int* w, const int b) {
+  const __m128i count = _mm_cvtsi32_si128(32 - b);
+  __m256i v;
+  int g;
+
+  for (g = 0; g < 8; g += 2) {
+    v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (w + window[b][g]))),
+                                _mm_loadu_si128((const __m128i*) (w + window[b][g + 1])), 1);
+    v = _mm256_shuffle_epi8(v, _mm256_load_si256((const __m256i*) shuf[b][g]));
+    v = _mm256_sllv_epi32(v, _mm256_load_si256((const __m256i*) shl[b][g]));
+    _mm256_storeu_si256((__m256i*) (p + 4 * g), _mm256_srl_epi32(v, count));
+  }
+}
+
+// The windows of the last chunks may go past the b*BS/32 words of the block,
+// those chunks are copied to a local buffer so we never read out of it.
+#define UNPACK_BLOCK(kernel, p, w, BS, b)                       \
+  do {                                                          \
+    unsigned int tmp_[SIMD_MAX_B + 4];                          \
+    unsigned int* end_ = (w) + (((b) * (BS)) >> 5);             \
+    int i_;                                                     \
+    for (i_ = 0; i_ < (BS); i_ += 32, (p) += 32, (w) += (b)) {  \
+      if ((w) + SIMD_REACH(b) <= end_) {                        \
+        kernel((p), (w), (b));                                  \
+      } else {                                                  \
+        memcpy(tmp_, (w), (b) * sizeof(unsigned int));          \
+        memset(tmp_ + (b), 0, 4 * sizeof(unsigned int));        \
+        kernel((p), tmp_, (b));                                 \
+      }                                                         \
+    }                                                           \
+  } while (0)
+
+#define UNPACK_SIMD(n, unused)                                         \
+  __attribute__((target("sse4.1")))                                    \
+  static void unpack##n##_sse(unsigned int* p, unsigned int* w, int BS) { \
+    UNPACK_BLOCK(unpack_chunk_sse, p, w, BS, n);                       \
+  }                                                                    \
+  __attribute__((target("avx2")))                                      \
+  static void unpack##n##_avx2(unsigned int* p, unsigned int* w, int BS) { \
+    UNPACK_BLOCK(unpack_chunk_avx2, p, w, BS, n);                      \
+  }
+
+// Versions for the block sizes of UNPACK_BLOCK_SIZES, see unpack.c.
+#define UNPACK_SIMD_FIXED(n, bs)                                       \
+  __attribute__((target("sse4.1")))                                    \
+  static void unpack##n##_##bs##_sse(unsigned int* p, unsigned int* w, int BS) { \
+    UNPACK_BLOCK(unpack_chunk_sse, p, w, bs, n);                       \
+  }                                                                    \
+  __attribute__((target("avx2")))                                      \
+  static void unpack##n##_##bs##_avx2(unsigned int* p, unsigned int* w, int BS) { \
+    UNPACK_BLOCK(unpack_chunk_avx2, p, w, bs, n);                      \
+  }
+
+#define UNPACK_SIMD_FIXED_ALL(bs) SIMD_WIDTHS(UNPACK_SIMD_FIXED, bs)
+#define UNPACK_SIMD_NAME(n, suffix) unpack##n##suffix,
+#define UNPACK_SIMD_SSE(bs) {NULL, SIMD_WIDTHS(UNPACK_SIMD_NAME, _##bs##_sse)},
+#define UNPACK_SIMD_AVX2(bs) {NULL, SIMD_WIDTHS(UNPACK_SIMD_NAME, _##bs##_avx2)},
+
+SIMD_WIDTHS(UNPACK_SIMD, )
+UNPACK_BLOCK_SIZES(UNPACK_SIMD_FIXED_ALL)
+
+// Same layout as unpack[] and unpack_fixed[] in unpack.c, indexed by b. 0 and
+// 26 to 32 bits keep the scalar version.
+static pf unpack_sse[SIMD_MAX_B + 1] = {NULL, SIMD_WIDTHS(UNPACK_SIMD_NAME, _sse)};
+static pf unpack_avx2[SIMD_MAX_B + 1] = {NULL, SIMD_WIDTHS(UNPACK_SIMD_NAME, _avx2)};
+static pf unpack_fixed_sse[UNPACK_NUM_BLOCK_SIZES][SIMD_MAX_B + 1] = {UNPACK_BLOCK_SIZES(UNPACK_SIMD_SSE)};
+static pf unpack_fixed_avx2[UNPACK_NUM_BLOCK_SIZES][SIMD_MAX_B + 1] = {UNPACK_BLOCK_SIZES(UNPACK_SIMD_AVX2)};
+
+static void install(pf* table, pf* simd) {
+  int b;
+
+  for (b = 1; b <= SIMD_MAX_B; b++)
+    table[b] = simd[b];
+}
+
+__attribute__((constructor))
+void unpack_simd_init(void) {
+  static int done = 0;
+  int i;
+
+  if (done)
+    return;
+  done = 1;
+
+  init_tables();
+  __builtin_cpu_init();
+  if (getenv("CODEC_SCALAR") != NULL)
+    return;
+  if (__builtin_cpu_supports("avx2")) {
+    install(unpack, unpack_avx2);
+    for (i = 0; i < UNPACK_NUM_BLOCK_SIZES; i++)
+      install(unpack_fixed[i], unpack_fixed_avx2[i]);
+  } else if (__builtin_cpu_supports("sse4.1")) {
+    install(unpack, unpack_sse);
+    for (i = 0; i < UNPACK_NUM_BLOCK_SIZES; i++)
+      install(unpack_fixed[i], unpack_fixed_sse[i]);
+  }
+}
+
+#else
+
+void unpack_simd_init(void) {
+}
+
+#endif
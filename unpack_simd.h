@@ -0,0 +1,28 @@
+////
+// Copyright (c) 2012 Universidad de Concepción, Chile.
+//
+// Author: Diego Caro
+//
+// @UDEC_LICENSE_HEADER_START@
+//
+// @UDEC_LICENSE_HEADER_END@
+
+////
+// SSE4.1 and AVX2 versions of the unpack functions defined in unpack.h.
+// They decode exactly the same format (b-bit values packed MSB first into
+// 32-bit words), so the compressed data does not depend on the kernels used.
+//
+// The best kernels supported by the CPU are installed in the unpack[] table
+// at program startup; the scalar functions of unpack.c remain as fallback.
+// With CODEC_SCALAR set in the environment, this and the other SIMD kernels
+// (pack_simd.c, s16.c, intersect.c) are left out, so the fallbacks can be
+// tested on any CPU; 'make check' runs both ways.
+
+#ifndef UNPACK_SIMD_H_
+#define UNPACK_SIMD_H_
+
+// Installs the SIMD kernels in unpack[]. It runs automatically before main(),
+// calling it again is harmless.
+void unpack_simd_init(void);
+
+#endif /* UNPACK_SIMD_H_ */